@@ -0,0 +1,110 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+namespace sy22 {
+
+	namespace {
+
+		std::atomic<long> allocations(0);
+		// Open scopes of this thread
+		thread_local int depth = 0;
+
+	};
+
+	AllocationScope::AllocationScope() {
+		depth++;
+	}
+
+	AllocationScope::~AllocationScope() {
+		depth--;
+	}
+
+	long scoped_allocations() {
+		return allocations.load(std::memory_order_relaxed);
+	}
+
+#if defined(NDEBUG)
+
+	bool allocations_counted() {
+		return false;
+	}
+
+#else
+
+	bool allocations_counted() {
+		return true;
+	}
+
+	namespace {
+
+		void* allocate(std::size_t size) {
+			if (depth > 0) {
+				allocations.fetch_add(1, std::memory_order_relaxed);
+			}
+			void* p = std::malloc(size ? size : 1);
+			if (!p) {
+				throw std::bad_alloc();
+			}
+			return p;
+		}
+
+		void* allocate(std::size_t size, const std::nothrow_t&) noexcept {
+			try {
+				return allocate(size);
+			} catch (...) {
+				return nullptr;
+			}
+		}
+
+	};
+
+#endif
+
+};
+
+#if !defined(NDEBUG)
+
+void* operator new(std::size_t size) {
+	return sy22::allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+	return sy22::allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t& tag) noexcept {
+	return sy22::allocate(size, tag);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+	return sy22::allocate(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+	std::free(p);
+}
+
+#endif
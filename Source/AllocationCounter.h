@@ -0,0 +1,33 @@
+#ifndef _ALLOCATION_COUNTER_H_
+#define _ALLOCATION_COUNTER_H_ 1
+
+namespace sy22 {
+
+	/**
+	 * True if this build replaces operator new to count allocations.
+	 * Debug builds do; with NDEBUG defined nothing is counted.
+	 */
+	bool allocations_counted();
+
+	/**
+	 * Heap allocations made so far by threads inside an AllocationScope.
+	 */
+	long scoped_allocations();
+
+	/**
+	 * Allocations of the constructing thread are counted for the
+	 * lifetime of the scope, e.g. an audio callback. Scopes nest.
+	 */
+	class AllocationScope {
+		public:
+		AllocationScope();
+		~AllocationScope();
+
+		private:
+		AllocationScope(const AllocationScope&);
+		AllocationScope& operator=(const AllocationScope&);
+	};
+
+};
+
+#endif
@@ -0,0 +1,246 @@
+#include <algorithm>
+
+#include "BankUpload.h"
+
+namespace sy22 {
+
+	const std::size_t BankUpload::max_window;
+	const std::size_t BankUpload::default_window;
+	const unsigned BankUpload::max_attempts;
+
+	BankUpload::BankUpload() :
+		count_(0),
+		queue_head_(0),
+		queued_count_(0),
+		in_flight_count_(0),
+		window_(default_window),
+		timeout_(0),
+		deadline_(0),
+		overdue_count_(0),
+		verified_count_(0),
+		failed_count_(0),
+		retransmits_(0) {}
+
+	void BankUpload::start(const Voice* voices, std::size_t count,
+			double timeout, std::size_t window) {
+		count_ = std::min(count, bank_voices);
+		window_ = std::max<std::size_t>(1, std::min(window, max_window));
+		timeout_ = timeout;
+
+		for (std::size_t i = 0; i < count_; i++) {
+			voices_[i] = voices[i];
+			hashes_[i] = content_hash(voices[i]);
+			states_[i] = queued;
+			attempts_[i] = 0;
+			queue_[i] = i;
+		}
+		std::fill(states_ + count_, states_ + bank_voices,
+				static_cast<unsigned char>(idle));
+
+		queue_head_ = 0;
+		queued_count_ = count_;
+		in_flight_count_ = 0;
+		overdue_count_ = 0;
+		verified_count_ = 0;
+		failed_count_ = 0;
+		retransmits_ = 0;
+	}
+
+	void BankUpload::cancel() {
+		for (std::size_t i = 0; i < count_; i++) {
+			if (states_[i] == queued || states_[i] == in_flight) {
+				states_[i] = idle;
+			}
+		}
+		queued_count_ = 0;
+		in_flight_count_ = 0;
+		overdue_count_ = 0;
+	}
+
+	bool BankUpload::next(std::size_t& memory, double now) {
+		expire_overdue(now);
+		if (queued_count_ == 0 || in_flight_count_ == window_) {
+			return false;
+		}
+
+		// The first queued voice whose answer can be told apart from
+		// those still to come, moved to the head of the queue
+		std::size_t k = 0;
+		while (!distinct(queue_[(queue_head_ + k) % bank_voices])) {
+			if (++k == queued_count_) {
+				return false;
+			}
+		}
+		memory = queue_[(queue_head_ + k) % bank_voices];
+		for (; k > 0; k--) {
+			queue_[(queue_head_ + k) % bank_voices] =
+				queue_[(queue_head_ + k - 1) % bank_voices];
+		}
+		queue_head_ = (queue_head_ + 1) % bank_voices;
+		queued_count_--;
+
+		if (in_flight_count_ == 0) {
+			deadline_ = now + timeout_;
+		}
+		in_flight_[in_flight_count_++] = memory;
+		states_[memory] = in_flight;
+		attempts_[memory]++;
+		return true;
+	}
+
+	bool BankUpload::received(const Voice& v, double now) {
+		const std::uint64_t hash = content_hash(v);
+		expire_overdue(now);
+
+		// Late answer to an overdue request. Only its own voice memory can
+		// have that hash, so it verifies it whether it has been sent again
+		// or not. A request in flight for it still expects its answer.
+		for (std::size_t j = 0; j < overdue_count_; j++) {
+			if (hashes_[overdue_[j]] == hash) {
+				accept(overdue_[j]);
+				std::copy(overdue_ + j + 1, overdue_ + overdue_count_, overdue_);
+				std::copy(overdue_since_ + j + 1, overdue_since_ + overdue_count_,
+						overdue_since_);
+				overdue_count_ -= j + 1;
+				return true;
+			}
+		}
+
+		std::size_t i = 0;
+		while (i < in_flight_count_ && hashes_[in_flight_[i]] != hash) {
+			i++;
+		}
+
+		if (i == in_flight_count_) {
+			// Arrived, but not as sent. Take it as the answer to the
+			// oldest request.
+			if (in_flight_count_ == 0) {
+				return false;
+			}
+			retry(in_flight_[0]);
+			pop_in_flight(1, now);
+			return true;
+		}
+
+		for (std::size_t j = 0; j < i; j++) {
+			retry(in_flight_[j]);
+		}
+		// Answers of anything older won't come any more
+		overdue_count_ = 0;
+		accept(in_flight_[i]);
+		pop_in_flight(i + 1, now);
+		return true;
+	}
+
+	void BankUpload::update(double now) {
+		expire_overdue(now);
+		if (in_flight_count_ > 0 && now >= deadline_) {
+			if (states_[in_flight_[0]] != verified) {
+				if (overdue_count_ == max_window) {
+					expire_overdue(overdue_since_[0] + timeout_);
+				}
+				overdue_[overdue_count_] = in_flight_[0];
+				overdue_since_[overdue_count_] = now;
+				overdue_count_++;
+			}
+			retry(in_flight_[0]);
+			pop_in_flight(1, now);
+		}
+	}
+
+	bool BankUpload::active() const {
+		if (queued_count_ > 0) {
+			return true;
+		}
+		// Answers still to come for voices already verified don't count
+		for (std::size_t i = 0; i < in_flight_count_; i++) {
+			if (states_[in_flight_[i]] != verified) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void BankUpload::hold(double now) {
+		deadline_ = std::max(deadline_, now + timeout_);
+	}
+
+	void BankUpload::retry(std::size_t memory) {
+		if (states_[memory] == verified) {
+			return;
+		}
+		if (attempts_[memory] >= max_attempts) {
+			states_[memory] = failed;
+			failed_count_++;
+			return;
+		}
+
+		queue_[(queue_head_ + queued_count_) % bank_voices] = memory;
+		queued_count_++;
+		states_[memory] = queued;
+		retransmits_++;
+	}
+
+	void BankUpload::accept(std::size_t memory) {
+		switch (states_[memory]) {
+			case verified:
+				return;
+			case failed:
+				failed_count_--;
+				break;
+			case queued:
+				unqueue(memory);
+				break;
+			default:
+				break;
+		}
+		states_[memory] = verified;
+		verified_count_++;
+	}
+
+	void BankUpload::unqueue(std::size_t memory) {
+		std::size_t k = 0;
+		while (queue_[(queue_head_ + k) % bank_voices] != memory) {
+			k++;
+		}
+		for (; k + 1 < queued_count_; k++) {
+			queue_[(queue_head_ + k) % bank_voices] =
+				queue_[(queue_head_ + k + 1) % bank_voices];
+		}
+		queued_count_--;
+	}
+
+	bool BankUpload::distinct(std::size_t memory) const {
+		const std::uint64_t hash = hashes_[memory];
+		for (std::size_t i = 0; i < in_flight_count_; i++) {
+			if (hashes_[in_flight_[i]] == hash) {
+				return false;
+			}
+		}
+		// An overdue answer of the same voice memory verifies it either way
+		for (std::size_t i = 0; i < overdue_count_; i++) {
+			if (overdue_[i] != memory && hashes_[overdue_[i]] == hash) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void BankUpload::expire_overdue(double now) {
+		std::size_t n = 0;
+		while (n < overdue_count_ && now >= overdue_since_[n] + timeout_) {
+			n++;
+		}
+		std::copy(overdue_ + n, overdue_ + overdue_count_, overdue_);
+		std::copy(overdue_since_ + n, overdue_since_ + overdue_count_, overdue_since_);
+		overdue_count_ -= n;
+	}
+
+	void BankUpload::pop_in_flight(std::size_t n, double now) {
+		std::copy(in_flight_ + n, in_flight_ + in_flight_count_, in_flight_);
+		in_flight_count_ -= n;
+		// The next answer is due a timeout after this one
+		deadline_ = now + timeout_;
+	}
+
+};
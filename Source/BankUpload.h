@@ -0,0 +1,150 @@
+#ifndef _BANK_UPLOAD_H_
+#define _BANK_UPLOAD_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Bank upload with read-back. Each voice goes out as a Program
+	 * Change, its Single Voice Dump and a dump request, and the dump
+	 * the SY22 answers with is compared to what was sent by content
+	 * hash. Up to window voices are in flight at once; voices that come
+	 * back different, or not at all, are sent again. Answers carry no
+	 * voice memory, so a voice waits while an answer to an identical one
+	 * in another memory may still come. Answers later than a timeout
+	 * after their request was given up on are taken as lost.
+	 *
+	 * Only decides what to send next, sending and receiving is up to
+	 * the caller. Times are in seconds on any clock.
+	 */
+	class BankUpload {
+		public:
+		static const std::size_t max_window = 8;
+		static const std::size_t default_window = 4;
+		// Sends of a voice before it is given up on
+		static const unsigned max_attempts = 4;
+
+		enum State {
+			idle,
+			queued,
+			in_flight,
+			verified,
+			failed
+		};
+
+		BankUpload();
+
+		/**
+		 * Start uploading count voices, at most bank_voices, to voice
+		 * memories 0 to count - 1. An answer to the oldest request is
+		 * expected within timeout of it being sent, or of the previous
+		 * answer, whichever is later.
+		 */
+		void start(const Voice* voices, std::size_t count,
+				double timeout, std::size_t window = default_window);
+
+		void cancel();
+
+		/**
+		 * Voice memory to send next, if the window has room. Marks it
+		 * in flight as of now. Voices identical to one in flight, or to
+		 * an overdue one in another memory, are passed over for now.
+		 */
+		bool next(std::size_t& memory, double now);
+
+		/**
+		 * Match a voice read back from the device against the requests
+		 * in flight. Answers come in request order, so requests older
+		 * than the one matched have lost theirs and are sent again. A
+		 * late answer to an overdue request verifies its voice memory.
+		 * Returns false if the voice wasn't expected.
+		 */
+		bool received(const Voice& v, double now);
+
+		/**
+		 * Send the oldest voice in flight again if its answer is overdue.
+		 */
+		void update(double now);
+
+		/**
+		 * Requests are still waiting to go out behind other traffic,
+		 * nothing is overdue before a timeout from now.
+		 */
+		void hold(double now);
+
+		/**
+		 * Voices are left to send or to be verified.
+		 */
+		bool active() const;
+
+		const Voice& voice(std::size_t memory) const {
+			return voices_[memory];
+		}
+
+		State state(std::size_t memory) const {
+			return static_cast<State>(states_[memory]);
+		}
+
+		std::size_t size() const {
+			return count_;
+		}
+
+		std::size_t verified_count() const {
+			return verified_count_;
+		}
+
+		std::size_t failed_count() const {
+			return failed_count_;
+		}
+
+		std::size_t retransmits() const {
+			return retransmits_;
+		}
+
+		private:
+		// Put memory back in the send queue, or give up on it
+		void retry(std::size_t memory);
+		void pop_in_flight(std::size_t n, double now);
+		void accept(std::size_t memory);
+		void unqueue(std::size_t memory);
+		bool distinct(std::size_t memory) const;
+		void expire_overdue(double now);
+
+		Voice voices_[bank_voices];
+		std::uint64_t hashes_[bank_voices];
+		unsigned char states_[bank_voices];
+		unsigned char attempts_[bank_voices];
+		std::size_t count_;
+
+		// Ring of voice memories waiting to be sent
+		std::size_t queue_[bank_voices];
+		std::size_t queue_head_;
+		std::size_t queued_count_;
+
+		// Requests awaiting their answer, oldest first
+		std::size_t in_flight_[max_window];
+		std::size_t in_flight_count_;
+		std::size_t window_;
+
+		double timeout_;
+		// When the oldest request in flight is overdue
+		double deadline_;
+
+		// Voice memories of requests given up on since the last answer,
+		// and when, oldest first. Their answers may still arrive.
+		std::size_t overdue_[max_window];
+		double overdue_since_[max_window];
+		std::size_t overdue_count_;
+
+		std::size_t verified_count_;
+		std::size_t failed_count_;
+		std::size_t retransmits_;
+	};
+
+};
+
+#endif
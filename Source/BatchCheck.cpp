@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "BatchCheck.h"
+#include "Librarian.h"
+
+namespace sy22 {
+
+	namespace {
+
+		/**
+		 * Indices of files still to check, owned by one thread. The
+		 * owner takes from the front, thieves from the back.
+		 */
+		class WorkQueue {
+			public:
+			void push(std::size_t i) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				items_.push_back(i);
+			}
+
+			bool pop(std::size_t& i) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (items_.empty()) {
+					return false;
+				}
+				i = items_.front();
+				items_.pop_front();
+				return true;
+			}
+
+			bool steal(std::size_t& i) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (items_.empty()) {
+					return false;
+				}
+				i = items_.back();
+				items_.pop_back();
+				return true;
+			}
+
+			private:
+			std::mutex mutex_;
+			std::deque<std::size_t> items_;
+		};
+
+		bool write_at(int fd, std::size_t offset, const void* data,
+				std::size_t size) {
+			return pwrite(fd, data, size, offset) == static_cast<ssize_t>(size);
+		}
+
+	};
+
+	FileReport check_file(const std::string& path, bool repair) {
+		FileReport report = {};
+
+		MappedFile file;
+		if (!file.open(path)) {
+			return report;
+		}
+		report.readable = true;
+
+		std::vector<std::size_t> broken;
+
+		report.truncated = !for_each_message(file.data(), file.size(),
+				[&](std::size_t offset, const unsigned char* data,
+					std::size_t size) {
+			if (size != sizeof(SingleVoiceDump)) {
+				return;
+			}
+			const SingleVoiceDump& svd =
+				*reinterpret_cast<const SingleVoiceDump*>(data);
+			if (!is_framed(svd)) {
+				return;
+			}
+
+			report.voices++;
+			bool sysex_ok = sysex_checksum_ok(svd);
+			bool voice_ok = checksum_ok(svd.voice_data);
+			report.bad_sysex_checksums += !sysex_ok;
+			report.bad_voice_checksums += !voice_ok;
+			if (!sysex_ok || !voice_ok) {
+				broken.push_back(offset);
+			}
+		});
+
+		report.broken = broken.size();
+		if (!repair || broken.empty()) {
+			return report;
+		}
+
+		int fd = ::open(path.c_str(), O_WRONLY);
+		if (fd < 0) {
+			return report;
+		}
+
+		for (std::size_t offset : broken) {
+			SingleVoiceDump svd =
+				*reinterpret_cast<const SingleVoiceDump*>(file.data() + offset);
+			svd.update_checksum();
+
+			// Only the checksum bytes change
+			bool written = write_at(fd,
+					offset + offsetof(SingleVoiceDump, voice_data) +
+					offsetof(Voice, checksum),
+					&svd.voice_data.checksum, sizeof(svd.voice_data.checksum)) &&
+				write_at(fd, offset + offsetof(SingleVoiceDump, checksum),
+						&svd.checksum, sizeof(svd.checksum));
+			if (!written) {
+				break;
+			}
+			report.repaired++;
+		}
+
+		::close(fd);
+		return report;
+	}
+
+	std::vector<FileReport> check_files(const std::vector<std::string>& paths,
+			bool repair, unsigned threads) {
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		threads = static_cast<unsigned>(
+				std::min<std::size_t>(threads, std::max<std::size_t>(1, paths.size())));
+
+		std::vector<FileReport> reports(paths.size());
+		std::vector<WorkQueue> queues(threads);
+		for (std::size_t i = 0; i < paths.size(); i++) {
+			queues[i % threads].push(i);
+		}
+
+		auto worker = [&](unsigned self) {
+			std::size_t i;
+			for (;;) {
+				bool found = queues[self].pop(i);
+				for (unsigned k = 1; !found && k < threads; k++) {
+					found = queues[(self + k) % threads].steal(i);
+				}
+				if (!found) {
+					// Nothing is ever added back, so all work is taken
+					return;
+				}
+				reports[i] = check_file(paths[i], repair);
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for (unsigned t = 1; t < threads; t++) {
+			pool.emplace_back(worker, t);
+		}
+		worker(0);
+		for (std::thread& t : pool) {
+			t.join();
+		}
+
+		return reports;
+	}
+
+};
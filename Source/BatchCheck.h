@@ -0,0 +1,81 @@
+#ifndef _BATCH_CHECK_H_
+#define _BATCH_CHECK_H_ 1
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Call f(offset, data, size) for every complete SysEx message in
+	 * data. Any status byte but EOX cuts a message off, and the search
+	 * for the next one goes on from there, so a truncated dump doesn't
+	 * swallow the one after it. Returns false if any message was cut
+	 * off, by a status byte or the end of data.
+	 */
+	template <class F>
+	bool for_each_message(const unsigned char* data, std::size_t size, F f) {
+		const unsigned char* end = data + size;
+		const unsigned char* p = data;
+		bool complete = true;
+
+		while ((p = static_cast<const unsigned char*>(
+						std::memchr(p, 0xF0, end - p)))) {
+			const unsigned char* q = p + 1;
+			while (q < end && *q < 0x80) {
+				q++;
+			}
+			if (q == end || *q != 0xF7) {
+				complete = false;
+				p = q;
+				continue;
+			}
+			f(p - data, p, q + 1 - p);
+			p = q + 1;
+		}
+
+		return complete;
+	}
+
+	/**
+	 * Result of checking the voice dumps of one .syx file.
+	 */
+	struct FileReport {
+		bool readable;
+		bool truncated;
+		std::size_t voices;
+		// Dumps with a wrong 7-bit SysEx checksum
+		std::size_t bad_sysex_checksums;
+		// Dumps with a wrong Voice checksum
+		std::size_t bad_voice_checksums;
+		// Dumps with either checksum wrong
+		std::size_t broken;
+		std::size_t repaired;
+
+		bool ok() const {
+			return readable && !truncated && broken == 0;
+		}
+	};
+
+	/**
+	 * Check all Single Voice Dumps of a file. With repair, dumps with
+	 * wrong checksums are rewritten in place.
+	 */
+	FileReport check_file(const std::string& path, bool repair);
+
+	/**
+	 * Check files on given number of threads, 0 for one per core. Files
+	 * are dealt out to per-thread queues and idle threads steal from the
+	 * others, so a few large files don't hold up the rest. Reports are
+	 * in the order of paths.
+	 */
+	std::vector<FileReport> check_files(const std::vector<std::string>& paths,
+			bool repair, unsigned threads = 0);
+
+};
+
+#endif
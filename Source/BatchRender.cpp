@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BatchRender.h"
+
+namespace sy22 {
+
+	const std::size_t WavWriter::block_frames;
+	const std::size_t RenderSettings::max_notes;
+
+	namespace {
+
+		// Frames rendered between note events at most
+		const std::size_t render_block = 256;
+
+		void put16(unsigned char* p, std::uint32_t v) {
+			p[0] = v & 0xFF;
+			p[1] = (v >> 8) & 0xFF;
+		}
+
+		void put32(unsigned char* p, std::uint32_t v) {
+			put16(p, v & 0xFFFF);
+			put16(p + 2, v >> 16);
+		}
+
+		std::int16_t to_pcm(float x) {
+			x = std::max(-1.0f, std::min(1.0f, x));
+			return static_cast<std::int16_t>(x * 32767.0f);
+		}
+
+		// Seconds until the last note ends
+		double pattern_length(const RenderSettings& settings) {
+			const std::size_t count =
+				std::min(settings.note_count, RenderSettings::max_notes);
+			double end = 0.0;
+			for (std::size_t i = 0; i < count; i++) {
+				end = std::max(end,
+						settings.notes[i].start + settings.notes[i].length);
+			}
+			return end;
+		}
+
+		struct Event {
+			long frame;
+			int key;
+			int velocity;
+
+			bool operator <(const Event& other) const {
+				return frame < other.frame;
+			}
+		};
+
+	};
+
+	WavWriter::WavWriter() :
+		file_(nullptr),
+		sample_rate_(0),
+		frames_(0),
+		ok_(false) {}
+
+	WavWriter::~WavWriter() {
+		close();
+	}
+
+	bool WavWriter::open(const std::string& path, unsigned sample_rate) {
+		close();
+		file_ = std::fopen(path.c_str(), "wb");
+		sample_rate_ = sample_rate;
+		frames_ = 0;
+		// Sizes are filled in by close
+		ok_ = file_ && write_header();
+		return ok_;
+	}
+
+	bool WavWriter::write_header() {
+		const std::uint32_t channels = 2;
+		const std::uint32_t block_align = channels * sizeof(std::int16_t);
+		const std::uint32_t data_size = frames_ * block_align;
+
+		unsigned char header[44];
+		std::copy("RIFF", "RIFF" + 4, header);
+		put32(header + 4, 36 + data_size);
+		std::copy("WAVEfmt ", "WAVEfmt " + 8, header + 8);
+		put32(header + 16, 16);
+		// PCM
+		put16(header + 20, 1);
+		put16(header + 22, channels);
+		put32(header + 24, sample_rate_);
+		put32(header + 28, sample_rate_ * block_align);
+		put16(header + 32, block_align);
+		put16(header + 34, 16);
+		std::copy("data", "data" + 4, header + 36);
+		put32(header + 40, data_size);
+
+		return std::fseek(file_, 0, SEEK_SET) == 0 &&
+			std::fwrite(header, 1, sizeof(header), file_) == sizeof(header);
+	}
+
+	bool WavWriter::write(const float* left, const float* right,
+			std::size_t frames) {
+		while (ok_ && frames > 0) {
+			const std::size_t n = std::min(frames, block_frames);
+			for (std::size_t i = 0; i < n; i++) {
+				samples_[2 * i] = to_pcm(left[i]);
+				samples_[2 * i + 1] = to_pcm(right[i]);
+			}
+			// RIFF is little-endian, as is everything we build for
+			ok_ = std::fwrite(samples_, 2 * sizeof(std::int16_t), n, file_) == n;
+			frames_ += static_cast<std::uint32_t>(n);
+			left += n;
+			right += n;
+			frames -= n;
+		}
+		return ok_;
+	}
+
+	bool WavWriter::close() {
+		if (!file_) {
+			return false;
+		}
+		bool ok = ok_ && write_header();
+		ok = std::fclose(file_) == 0 && ok;
+		file_ = nullptr;
+		ok_ = false;
+		return ok;
+	}
+
+	RenderSettings default_render_settings() {
+		RenderSettings settings = {};
+		settings.sample_rate = 44100;
+		const RenderSettings::Note notes[] = {
+			{36, 100, 0.0, 0.6},
+			{60, 90, 0.8, 1.6},
+			{64, 90, 0.8, 1.6},
+			{67, 90, 0.8, 1.6},
+		};
+		settings.note_count = sizeof(notes) / sizeof(notes[0]);
+		std::copy(notes, notes + settings.note_count, settings.notes);
+		settings.tail = 1.2;
+		return settings;
+	}
+
+	bool render_preview(const Voice& v, const std::string& path,
+			const RenderSettings& settings, PreviewSynth& synth) {
+		const double rate = settings.sample_rate;
+		const std::size_t note_count =
+			std::min(settings.note_count, RenderSettings::max_notes);
+
+		Event events[2 * RenderSettings::max_notes];
+		std::size_t event_count = 0;
+		for (std::size_t i = 0; i < note_count; i++) {
+			const RenderSettings::Note& note = settings.notes[i];
+			events[event_count++] = {static_cast<long>(note.start * rate),
+				note.key, note.velocity};
+			events[event_count++] = {
+				static_cast<long>((note.start + note.length) * rate),
+				note.key, 0};
+		}
+		// Stable, so a note's off never comes before its on
+		std::stable_sort(events, events + event_count);
+		const long frames = static_cast<long>(
+				(pattern_length(settings) + settings.tail) * rate);
+
+		WavWriter wav;
+		if (!wav.open(path, settings.sample_rate)) {
+			return false;
+		}
+
+		synth.all_notes_off();
+		synth.set_sample_rate(rate);
+		synth.set_voice(v);
+
+		float left[render_block], right[render_block];
+		std::size_t next = 0;
+		for (long frame = 0; frame < frames;) {
+			while (next < event_count && events[next].frame <= frame) {
+				synth.note_on(events[next].key, events[next].velocity);
+				next++;
+			}
+
+			long until = std::min<long>(frames, frame + render_block);
+			if (next < event_count) {
+				until = std::min(until, events[next].frame);
+			}
+			const std::size_t n = static_cast<std::size_t>(until - frame);
+
+			std::fill(left, left + n, 0.0f);
+			std::fill(right, right + n, 0.0f);
+			synth.render(left, right, n);
+			if (!wav.write(left, right, n)) {
+				break;
+			}
+			frame = until;
+		}
+
+		synth.all_notes_off();
+		return wav.close();
+	}
+
+	std::string preview_name(std::size_t i, const char (&name)[8]) {
+		char number[24];
+		std::snprintf(number, sizeof(number), "%05zu_", i + 1);
+
+		std::string result = number;
+		for (char c : name) {
+			const bool safe = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') ||
+				(c >= 'a' && c <= 'z') || c == '-';
+			result += safe ? c : '_';
+		}
+		// Names are padded with spaces
+		result.erase(result.find_last_not_of('_') + 1);
+		return result + ".wav";
+	}
+
+	RenderReport render_previews(const Librarian& library,
+			const std::string& directory, const RenderSettings& settings,
+			unsigned threads) {
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		threads = static_cast<unsigned>(
+				std::min<std::size_t>(threads, std::max<std::size_t>(1, library.size())));
+
+		// Previews take the same time each, so handing them out one at
+		// a time off a counter keeps all threads busy to the end
+		std::atomic<std::size_t> next(0);
+		std::mutex mutex;
+		RenderReport report = {};
+		const double length = pattern_length(settings) + settings.tail;
+
+		auto worker = [&]() {
+			std::unique_ptr<PreviewSynth> synth(new PreviewSynth());
+			RenderReport own = {};
+
+			for (std::size_t i; (i = next++) < library.size();) {
+				const std::string path = directory + "/" +
+					preview_name(i, library.entry(i).name);
+				if (render_preview(library.voice(i), path, settings, *synth)) {
+					own.rendered++;
+				} else {
+					own.failed++;
+				}
+			}
+
+			own.seconds = own.rendered * length;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			report.rendered += own.rendered;
+			report.failed += own.failed;
+			report.seconds += own.seconds;
+		};
+
+		std::vector<std::thread> pool;
+		for (unsigned t = 1; t < threads; t++) {
+			pool.emplace_back(worker);
+		}
+		worker();
+		for (std::thread& t : pool) {
+			t.join();
+		}
+
+		return report;
+	}
+
+};
@@ -0,0 +1,108 @@
+#ifndef _BATCH_RENDER_H_
+#define _BATCH_RENDER_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "Librarian.h"
+#include "PreviewSynth.h"
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Streams 16-bit stereo PCM to a .wav file. Samples are converted
+	 * in blocks of fixed size, so memory use doesn't grow with length.
+	 */
+	class WavWriter {
+		public:
+		static const std::size_t block_frames = 1024;
+
+		WavWriter();
+		~WavWriter();
+
+		bool open(const std::string& path, unsigned sample_rate);
+
+		/**
+		 * Append frames, clipping samples to -1...1.
+		 */
+		bool write(const float* left, const float* right, std::size_t frames);
+
+		/**
+		 * Fill in the sizes of the header and close the file. Returns
+		 * false if anything failed to be written.
+		 */
+		bool close();
+
+		private:
+		WavWriter(const WavWriter&);
+		WavWriter& operator =(const WavWriter&);
+
+		bool write_header();
+
+		std::FILE* file_;
+		std::uint32_t sample_rate_;
+		std::uint32_t frames_;
+		bool ok_;
+		std::int16_t samples_[block_frames * 2];
+	};
+
+	/**
+	 * Notes every preview plays: a bass note, then a chord held on top
+	 * of it. Times are in seconds.
+	 */
+	struct RenderSettings {
+		static const std::size_t max_notes = 8;
+
+		struct Note {
+			int key;
+			int velocity;
+			double start;
+			double length;
+		};
+
+		unsigned sample_rate;
+		Note notes[max_notes];
+		std::size_t note_count;
+		// Release left to ring after the last note ends
+		double tail;
+	};
+
+	RenderSettings default_render_settings();
+
+	struct RenderReport {
+		std::size_t rendered;
+		std::size_t failed;
+		// Seconds of audio written
+		double seconds;
+	};
+
+	/**
+	 * Render the note pattern with v into a .wav file at path, using
+	 * synth. Returns false if the file can't be written.
+	 */
+	bool render_preview(const Voice& v, const std::string& path,
+			const RenderSettings& settings, PreviewSynth& synth);
+
+	/**
+	 * File name render_previews uses for entry i of a library:
+	 * number, then the voice name with anything unsafe replaced.
+	 */
+	std::string preview_name(std::size_t i, const char (&name)[8]);
+
+	/**
+	 * Render a preview of every voice in library into directory, on
+	 * given number of threads, 0 for one per core. Voices are decoded
+	 * from the mapped files only when their turn comes and each thread
+	 * streams its file out in blocks, so memory use is bounded by the
+	 * number of threads, not the size of the library.
+	 */
+	RenderReport render_previews(const Librarian& library,
+			const std::string& directory, const RenderSettings& settings,
+			unsigned threads = 0);
+
+};
+
+#endif
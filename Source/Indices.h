@@ -0,0 +1,30 @@
+#ifndef _INDICES_H_
+#define _INDICES_H_ 1
+
+#include <cstddef>
+
+namespace sy22 {
+
+	// C++11 has no std::index_sequence, roll our own with
+	// logarithmic instantiation depth. Used to expand constexpr
+	// functions into per-byte or per-field tables.
+	template <std::size_t... I> struct indices {};
+
+	template <class L, class R> struct concat;
+
+	template <std::size_t... L, std::size_t... R>
+	struct concat<indices<L...>, indices<R...>> {
+		using type = indices<L..., (sizeof...(L) + R)...>;
+	};
+
+	template <std::size_t N>
+	struct make_indices : concat<
+		typename make_indices<N / 2>::type,
+		typename make_indices<N - N / 2>::type> {};
+
+	template <> struct make_indices<0> { using type = indices<>; };
+	template <> struct make_indices<1> { using type = indices<0>; };
+
+};
+
+#endif
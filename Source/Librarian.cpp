@@ -0,0 +1,255 @@
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Librarian.h"
+
+namespace sy22 {
+
+	namespace {
+
+		const char index_magic[8] = {'S', 'Y', '2', '2', 'I', 'D', 'X', 0};
+		// 2: mtime in nanoseconds
+		const std::uint32_t index_version = 2;
+
+		/**
+		 * Index file layout, native byte order:
+		 *
+		 *   magic[8] version:u32 count:u32 size:u64 mtime:i64
+		 *   count * { name[8] offset:u64 hash:u64 type:u8 }
+		 */
+		struct IndexHeader {
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t count;
+			std::uint64_t size;
+			std::int64_t mtime;
+		};
+
+		const std::size_t record_size = 8 + 8 + 8 + 1;
+
+	};
+
+	MappedFile::MappedFile() : data_(nullptr), size_(0), mtime_(0) {}
+
+	MappedFile::MappedFile(MappedFile&& other) :
+		data_(other.data_),
+		size_(other.size_),
+		mtime_(other.mtime_) {
+		other.data_ = nullptr;
+		other.size_ = 0;
+	}
+
+	MappedFile& MappedFile::operator =(MappedFile&& other) {
+		if (this != &other) {
+			close();
+			data_ = other.data_;
+			size_ = other.size_;
+			mtime_ = other.mtime_;
+			other.data_ = nullptr;
+			other.size_ = 0;
+		}
+		return *this;
+	}
+
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+	bool MappedFile::open(const std::string& path) {
+		close();
+
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) < 0) {
+			::close(fd);
+			return false;
+		}
+
+		// Seconds alone miss a same size rewrite within the second
+#if defined(__APPLE__)
+		mtime_ = st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+		mtime_ = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+		size_ = static_cast<std::size_t>(st.st_size);
+
+		if (size_ > 0) {
+			void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED) {
+				::close(fd);
+				size_ = 0;
+				return false;
+			}
+			data_ = static_cast<const unsigned char*>(p);
+		}
+
+		// The mapping stays valid without the descriptor
+		::close(fd);
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (data_) {
+			munmap(const_cast<unsigned char*>(data_), size_);
+		}
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+	void scan(const unsigned char* data, std::size_t size,
+			std::uint32_t file, std::vector<LibraryEntry>& entries) {
+		const std::size_t dump_size = sizeof(SingleVoiceDump);
+		if (size < dump_size) {
+			return;
+		}
+
+		const unsigned char* end = data + size - dump_size + 1;
+		const unsigned char* p = data;
+
+		while ((p = static_cast<const unsigned char*>(
+						std::memchr(p, 0xF0, end - p)))) {
+			const SingleVoiceDump& svd =
+				*reinterpret_cast<const SingleVoiceDump*>(p);
+
+			if (!is_valid(svd)) {
+				p++;
+				continue;
+			}
+
+			LibraryEntry e;
+			std::memcpy(e.name, svd.voice_data.name, sizeof(e.name));
+			e.file = file;
+			e.offset = p - data;
+			e.hash = content_hash(svd.voice_data);
+			e.type = single_voice;
+			entries.push_back(e);
+
+			p += dump_size;
+			if (p >= end) {
+				break;
+			}
+		}
+	}
+
+	std::string Librarian::index_path(const std::string& path) {
+		return path + ".idx";
+	}
+
+	bool Librarian::add(const std::string& path) {
+		MappedFile file;
+		if (!file.open(path)) {
+			return false;
+		}
+
+		std::uint32_t file_no = static_cast<std::uint32_t>(files_.size());
+		std::size_t first = entries_.size();
+
+		if (!load_index(path, file, file_no)) {
+			scan(file.data(), file.size(), file_no, entries_);
+			save_index(path, file, first);
+		}
+
+		files_.push_back(std::move(file));
+		paths_.push_back(path);
+		return true;
+	}
+
+	bool Librarian::load_index(const std::string& path,
+			const MappedFile& file, std::uint32_t file_no) {
+		MappedFile index;
+		if (!index.open(index_path(path)) || index.size() < sizeof(IndexHeader)) {
+			return false;
+		}
+
+		IndexHeader header;
+		std::memcpy(&header, index.data(), sizeof(header));
+
+		// Anything off and the .syx gets rescanned
+		if (std::memcmp(header.magic, index_magic, sizeof(index_magic)) ||
+				header.version != index_version ||
+				header.size != file.size() ||
+				header.mtime != file.mtime() ||
+				index.size() != sizeof(header) + header.count * record_size) {
+			return false;
+		}
+
+		const unsigned char* r = index.data() + sizeof(header);
+		entries_.reserve(entries_.size() + header.count);
+
+		for (std::uint32_t i = 0; i < header.count; i++, r += record_size) {
+			LibraryEntry e;
+			std::memcpy(e.name, r, 8);
+			std::memcpy(&e.offset, r + 8, 8);
+			std::memcpy(&e.hash, r + 16, 8);
+			e.type = r[24];
+			e.file = file_no;
+
+			if (e.offset + sizeof(SingleVoiceDump) > file.size()) {
+				entries_.resize(entries_.size() - i);
+				return false;
+			}
+			entries_.push_back(e);
+		}
+
+		return true;
+	}
+
+	void Librarian::save_index(const std::string& path,
+			const MappedFile& file, std::size_t first) const {
+		// Index is a cache, failing to write it is not an error
+		std::string tmp = index_path(path) + ".tmp";
+		std::FILE* f = std::fopen(tmp.c_str(), "wb");
+		if (!f) {
+			return;
+		}
+
+		IndexHeader header;
+		std::memcpy(header.magic, index_magic, sizeof(index_magic));
+		header.version = index_version;
+		header.count = static_cast<std::uint32_t>(entries_.size() - first);
+		header.size = file.size();
+		header.mtime = file.mtime();
+
+		bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+
+		for (std::size_t i = first; ok && i < entries_.size(); i++) {
+			const LibraryEntry& e = entries_[i];
+			unsigned char r[record_size];
+			std::memcpy(r, e.name, 8);
+			std::memcpy(r + 8, &e.offset, 8);
+			std::memcpy(r + 16, &e.hash, 8);
+			r[24] = e.type;
+			ok = std::fwrite(r, record_size, 1, f) == 1;
+		}
+
+		if (std::fclose(f) != 0 || !ok ||
+				std::rename(tmp.c_str(), index_path(path).c_str()) != 0) {
+			std::remove(tmp.c_str());
+		}
+	}
+
+	const SingleVoiceDump& Librarian::dump(std::size_t i) const {
+		const LibraryEntry& e = entries_[i];
+		return *reinterpret_cast<const SingleVoiceDump*>(
+				files_[e.file].data() + e.offset);
+	}
+
+	Voice Librarian::voice(std::size_t i) const {
+		return dump(i).voice_data;
+	}
+
+	VoiceView Librarian::view(std::size_t i) const {
+		const LibraryEntry& e = entries_[i];
+		return VoiceView::from_dump(files_[e.file].data() + e.offset);
+	}
+
+};
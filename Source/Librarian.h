@@ -0,0 +1,132 @@
+#ifndef _LIBRARIAN_H_
+#define _LIBRARIAN_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Sy22.h"
+#include "VoiceView.h"
+
+namespace sy22 {
+
+	/**
+	 * Read-only memory mapping of a whole file.
+	 */
+	class MappedFile {
+		public:
+		MappedFile();
+		MappedFile(MappedFile&&);
+		MappedFile& operator =(MappedFile&&);
+		~MappedFile();
+
+		bool open(const std::string& path);
+		void close();
+
+		const unsigned char* data() const {
+			return data_;
+		}
+
+		std::size_t size() const {
+			return size_;
+		}
+
+		// Modification time in nanoseconds, for telling a stale index
+		// apart
+		std::int64_t mtime() const {
+			return mtime_;
+		}
+
+		private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator =(const MappedFile&);
+
+		const unsigned char* data_;
+		std::size_t size_;
+		std::int64_t mtime_;
+	};
+
+	enum DumpType {
+		single_voice = 1
+	};
+
+	/**
+	 * A valid dump found in a .syx file.
+	 */
+	struct LibraryEntry {
+		char name[8];
+		std::uint32_t file;
+		std::uint64_t offset;
+		std::uint64_t hash;
+		std::uint8_t type;
+	};
+
+	/**
+	 * Collection of voices in memory mapped .syx files. Files are
+	 * scanned once for valid dumps and the result is stored in an index
+	 * file next to them, so later opens only read the index. Voice data
+	 * is decoded only when asked for.
+	 */
+	class Librarian {
+		public:
+		/**
+		 * Map a .syx file and index its voices, reusing an up to date
+		 * index file if there is one. Returns false if the file can't
+		 * be read.
+		 */
+		bool add(const std::string& path);
+
+		std::size_t size() const {
+			return entries_.size();
+		}
+
+		const LibraryEntry& entry(std::size_t i) const {
+			return entries_[i];
+		}
+
+		/**
+		 * Raw dump of entry i, pointing into the mapped file.
+		 */
+		const SingleVoiceDump& dump(std::size_t i) const;
+
+		/**
+		 * Decode Voice of entry i.
+		 */
+		Voice voice(std::size_t i) const;
+
+		/**
+		 * Read fields of entry i in place, without copying the Voice.
+		 */
+		VoiceView view(std::size_t i) const;
+
+		const std::string& path(std::size_t file) const {
+			return paths_[file];
+		}
+
+		/**
+		 * Index file used for given .syx file.
+		 */
+		static std::string index_path(const std::string& path);
+
+		private:
+		bool load_index(const std::string& path, const MappedFile& file,
+				std::uint32_t file_no);
+		void save_index(const std::string& path, const MappedFile& file,
+				std::size_t first) const;
+
+		std::vector<MappedFile> files_;
+		std::vector<std::string> paths_;
+		std::vector<LibraryEntry> entries_;
+	};
+
+	/**
+	 * Find valid Single Voice Dumps in raw data and append them to
+	 * entries.
+	 */
+	void scan(const unsigned char* data, std::size_t size,
+			std::uint32_t file, std::vector<LibraryEntry>& entries);
+
+};
+
+#endif
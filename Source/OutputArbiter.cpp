@@ -0,0 +1,117 @@
+#include "OutputArbiter.h"
+
+namespace sy22 {
+
+	OutputArbiter::OutputArbiter() :
+		sample_rate_(44100.0),
+		bound_(default_latency_bound_ms * 44100.0 / 1000.0),
+		event_count_(0),
+		idle_(0.0),
+		busy_until_(0.0),
+		unit_count_(0),
+		events_total_(0),
+		late_total_(0),
+		max_latency_(0.0) {}
+
+	void OutputArbiter::set_sample_rate(double sample_rate) {
+		if (sample_rate > 0.0) {
+			const double scale = sample_rate / sample_rate_;
+			bound_ *= scale;
+			idle_ *= scale;
+			busy_until_ *= scale;
+			max_latency_ *= scale;
+			sample_rate_ = sample_rate;
+		}
+	}
+
+	void OutputArbiter::set_latency_bound(double seconds) {
+		bound_ = (seconds > 0.0 ? seconds : 0.0) * sample_rate_;
+	}
+
+	void OutputArbiter::begin_block() {
+		event_count_ = 0;
+		unit_count_ = 0;
+	}
+
+	void OutputArbiter::channel_event(long offset) {
+		if (event_count_ < max_events) {
+			events_[event_count_++] = offset;
+		}
+	}
+
+	long OutputArbiter::place(long slot, double wire_time, long block_size) const {
+		long start = slot;
+
+		if (wire_time > bound_) {
+			// Too long to fit between notes, wait for a pause in the
+			// channel traffic at least as long as the unit
+			double last = event_count_ ? events_[event_count_ - 1] : -idle_;
+			if (start - last < wire_time) {
+				start = static_cast<long>(last + wire_time);
+				if (start < slot) {
+					start = slot;
+				}
+			}
+		}
+
+		// Step past channel messages that would wait too long
+		for (std::size_t i = 0; i < event_count_ && start < block_size; i++) {
+			if (events_[i] >= start && events_[i] < start + wire_time - bound_) {
+				start = events_[i] + 1;
+			}
+		}
+
+		return start < block_size ? start : -1;
+	}
+
+	void OutputArbiter::sent(long offset, double wire_time) {
+		if (unit_count_ < max_units) {
+			unit_start_[unit_count_] = offset;
+			unit_end_[unit_count_] = offset + wire_time;
+			unit_count_++;
+		}
+	}
+
+	void OutputArbiter::end_block(long block_size) {
+		std::size_t unit = 0;
+		double busy = busy_until_;
+
+		for (std::size_t i = 0; i < event_count_; i++) {
+			const long at = events_[i];
+
+			// Units that started before this message, in send order
+			while (unit < unit_count_ && unit_start_[unit] < at) {
+				if (unit_end_[unit] > busy) {
+					busy = unit_end_[unit];
+				}
+				unit++;
+			}
+
+			const double latency = busy > at ? busy - at : 0.0;
+			if (latency > bound_) {
+				late_total_++;
+			}
+			if (latency > max_latency_) {
+				max_latency_ = latency;
+			}
+		}
+		events_total_ += event_count_;
+
+		for (; unit < unit_count_; unit++) {
+			if (unit_end_[unit] > busy) {
+				busy = unit_end_[unit];
+			}
+		}
+
+		busy_until_ = busy > block_size ? busy - block_size : 0.0;
+		idle_ = event_count_ ? block_size - events_[event_count_ - 1] :
+			idle_ + block_size;
+	}
+
+	void OutputArbiter::reset_stats() {
+		events_total_ = 0;
+		late_total_ = 0;
+		max_latency_ = 0.0;
+	}
+
+};
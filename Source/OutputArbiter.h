@@ -0,0 +1,97 @@
+#ifndef _OUTPUT_ARBITER_H_
+#define _OUTPUT_ARBITER_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sy22 {
+
+	/**
+	 * Places bulk SysEx units on the MIDI wire around the host's channel
+	 * messages. A channel message that falls on a SysEx message still
+	 * on the wire waits until it is done, so units are only started
+	 * where they delay the known channel messages of a block by no more
+	 * than the latency bound. Units longer than the bound additionally
+	 * wait for the channel traffic to pause for as long as they take.
+	 * Times are in samples within the current block.
+	 */
+	class OutputArbiter {
+		public:
+		// Most units and channel messages tracked per block
+		static const std::size_t max_units = 64;
+		static const std::size_t max_events = 512;
+
+		static const int default_latency_bound_ms = 10;
+
+		OutputArbiter();
+
+		void set_sample_rate(double sample_rate);
+		void set_latency_bound(double seconds);
+
+		double latency_bound() const {
+			return bound_ / sample_rate_;
+		}
+
+		/**
+		 * Start a block. Channel messages are then added in time order.
+		 */
+		void begin_block();
+		void channel_event(long offset);
+
+		/**
+		 * Earliest sample from slot on where a unit taking wire_time
+		 * samples may start, or -1 if there is none in this block.
+		 */
+		long place(long slot, double wire_time, long block_size) const;
+
+		/**
+		 * Record a unit sent. Units bypassing place() are recorded too,
+		 * so that the latency they cause is measured.
+		 */
+		void sent(long offset, double wire_time);
+
+		/**
+		 * Measure the delay of this block's channel messages and move
+		 * on to the next block.
+		 */
+		void end_block(long block_size);
+
+		std::uint64_t events() const {
+			return events_total_;
+		}
+
+		// Channel messages delayed by more than the bound
+		std::uint64_t late_events() const {
+			return late_total_;
+		}
+
+		// Worst delay so far, in seconds
+		double max_latency() const {
+			return max_latency_ / sample_rate_;
+		}
+
+		void reset_stats();
+
+		private:
+		double sample_rate_;
+		double bound_;
+
+		long events_[max_events];
+		std::size_t event_count_;
+		// Samples since the last channel message, at block start
+		double idle_;
+
+		// Wire busy with our units until, carried over between blocks
+		double busy_until_;
+		long unit_start_[max_units];
+		double unit_end_[max_units];
+		std::size_t unit_count_;
+
+		std::uint64_t events_total_;
+		std::uint64_t late_total_;
+		double max_latency_;
+	};
+
+};
+
+#endif
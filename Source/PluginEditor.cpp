@@ -27,6 +27,7 @@ Sy22PanelAudioProcessorEditor::Sy22PanelAudioProcessorEditor (Sy22PanelAudioProc
     effectDepth.setPopupDisplayEnabled(true, this);
     effectDepth.setTextValueSuffix(" Effect Depth");
     effectDepth.setValue(1);
+    effectDepth.addListener(this);
     addAndMakeVisible(&effectDepth);
 }
 
@@ -52,3 +53,15 @@ void Sy22PanelAudioProcessorEditor::resized()
     // Common voice controls
     effectDepth.setBounds(40, 30, 20, getHeight() - 60);
 }
+
+void Sy22PanelAudioProcessorEditor::sliderValueChanged (Slider* slider)
+{
+    if (slider == &effectDepth)
+    {
+        // DDDTTTT, keep the effect type as is
+        const uint8 effect = processor.getLastSentVoice().effect;
+        const int depth = roundToInt (effectDepth.getValue());
+        processor.editVoice (offsetof (sy22::Voice, effect),
+                             { 0, static_cast<uint8> ((depth << 4) | (effect & 0x0F)) });
+    }
+}
@@ -18,7 +18,8 @@
 //==============================================================================
 /**
 */
-class Sy22PanelAudioProcessorEditor  : public AudioProcessorEditor
+class Sy22PanelAudioProcessorEditor  : public AudioProcessorEditor,
+                                       private Slider::Listener
 {
 public:
     Sy22PanelAudioProcessorEditor (Sy22PanelAudioProcessor&);
@@ -29,6 +30,8 @@ public:
     void resized() override;
 
 private:
+    void sliderValueChanged (Slider*) override;
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     Sy22PanelAudioProcessor& processor;
@@ -11,14 +11,45 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+#include <cmath>
+
 
 //==============================================================================
 Sy22PanelAudioProcessor::Sy22PanelAudioProcessor()
+    : receivedVoice (sy22::make_voice()),
+      lastVoiceReceivedMs (0),
+      hasReceivedBank (false),
+      transmitEntryPos (0),
+      noteLatencyBoundUs (sy22::OutputArbiter::default_latency_bound_ms * 1000),
+      previewRunning (false),
+      previewVoiceHash (0),
+      loopbackRunning (false),
+      loopbackStats(),
+      stagedOutput (nullptr),
+      outputStalled (false),
+      lastSentVoice (sy22::make_voice()),
+      hasSentVoice (false),
+      currentProgram (0),
+      hostProgram (0),
+      hostProgramPending (0)
 {
+    programBanks.add (new sy22::ProgramBank());
+
+    for (std::size_t i = 0; i < sy22::parameter_count; ++i)
+        parameterValues[i] = sy22::get_parameter (lastSentVoice, sy22::parameters[i]);
+
+    for (int i = 0; i < numOutputBuffers; ++i)
+    {
+        outputBuffers[i].ensureSize (outputBufferBytes);
+        freeOutputQueue.push (&outputBuffers[i]);
+    }
+
+    startTimer (timerIntervalMs);
 }
 
 Sy22PanelAudioProcessor::~Sy22PanelAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -29,26 +60,41 @@ const String Sy22PanelAudioProcessor::getName() const
 
 int Sy22PanelAudioProcessor::getNumParameters()
 {
-    return 0;
+    return (int) sy22::parameter_count;
 }
 
 float Sy22PanelAudioProcessor::getParameter (int index)
 {
-    return 0.0f;
+    if (! isPositiveAndBelow (index, getNumParameters()))
+        return 0.0f;
+
+    return sy22::to_normalized (sy22::parameters[index], parameterValues[index].get());
 }
 
 void Sy22PanelAudioProcessor::setParameter (int index, float newValue)
 {
+    if (! isPositiveAndBelow (index, getNumParameters()))
+        return;
+
+    // Later values simply overwrite earlier ones until the next flush
+    parameterValues[index] = sy22::from_normalized (sy22::parameters[index], newValue);
+    parameterDirty[index] = 1;
 }
 
 const String Sy22PanelAudioProcessor::getParameterName (int index)
 {
-    return String();
+    if (! isPositiveAndBelow (index, getNumParameters()))
+        return String();
+
+    return sy22::parameters[index].name;
 }
 
 const String Sy22PanelAudioProcessor::getParameterText (int index)
 {
-    return String();
+    if (! isPositiveAndBelow (index, getNumParameters()))
+        return String();
+
+    return String (parameterValues[index].get());
 }
 
 const String Sy22PanelAudioProcessor::getInputChannelName (int channelIndex) const
@@ -101,26 +147,71 @@ double Sy22PanelAudioProcessor::getTailLengthSeconds() const
 
 int Sy22PanelAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return programBanks.size() * (int) sy22::bank_voices;
 }
 
 int Sy22PanelAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return hostProgram.get();
 }
 
 void Sy22PanelAudioProcessor::setCurrentProgram (int index)
 {
+    if (! isPositiveAndBelow (index, getNumPrograms()))
+        return;
+
+    hostProgram = index;
+    hostProgramPending = 1;
 }
 
 const String Sy22PanelAudioProcessor::getProgramName (int index)
 {
-    return String();
+    if (! isPositiveAndBelow (index, getNumPrograms()))
+        return String();
+
+    const sy22::Voice& voice = bankOf (index).voice (slotOf (index));
+    return String (voice.name, sizeof (voice.name)).trimEnd();
 }
 
 void Sy22PanelAudioProcessor::changeProgramName (int index, const String& newName)
 {
+    if (! isPositiveAndBelow (index, getNumPrograms()))
+        return;
+
+    const char* name = newName.toRawUTF8();
+    bankOf (index).set_name (slotOf (index), name, std::strlen (name));
+}
+
+int Sy22PanelAudioProcessor::getNumProgramBanks() const
+{
+    return programBanks.size();
+}
+
+void Sy22PanelAudioProcessor::setProgramBank (int bank, const sy22::Voice* voices)
+{
+    jassert (isPositiveAndBelow (bank, programBanks.size() + 1));
+
+    if (bank == programBanks.size())
+        programBanks.add (new sy22::ProgramBank());
+
+    programBanks.getUnchecked (bank)->set_bank (voices);
+    updateHostDisplay();
+}
+
+const sy22::Voice& Sy22PanelAudioProcessor::getProgramVoice (int index) const
+{
+    jassert (isPositiveAndBelow (index, programBanks.size() * (int) sy22::bank_voices));
+    return bankOf (index).voice (slotOf (index));
+}
+
+sy22::ProgramBank& Sy22PanelAudioProcessor::bankOf (int program) const
+{
+    return *programBanks.getUnchecked (program / (int) sy22::bank_voices);
+}
+
+std::size_t Sy22PanelAudioProcessor::slotOf (int program)
+{
+    return (std::size_t) program % sy22::bank_voices;
 }
 
 //==============================================================================
@@ -128,6 +219,10 @@ void Sy22PanelAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBl
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    transmitScheduler.set_sample_rate (sampleRate);
+    outputArbiter.set_sample_rate (sampleRate);
+    loopbackDevice.set_sample_rate (sampleRate);
+    previewSynth.set_sample_rate (sampleRate);
 }
 
 void Sy22PanelAudioProcessor::releaseResources()
@@ -138,6 +233,47 @@ void Sy22PanelAudioProcessor::releaseResources()
 
 void Sy22PanelAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    // Debug builds count whatever this thread allocates from here on
+    const sy22::AllocationScope allocationScope;
+
+    // Look for voice dumps coming from the SY22. Uses the raw data
+    // overload of getNextEvent so that SysEx isn't copied to the heap.
+    {
+        MidiBuffer::Iterator it (midiMessages);
+        const uint8* data;
+        int size, samplePosition;
+
+        outputArbiter.set_latency_bound (noteLatencyBoundUs.get() / 1.0e6);
+        outputArbiter.begin_block();
+
+        while (it.getNextEvent (data, size, samplePosition))
+        {
+            // Note and controller messages passing through to the SY22
+            if (size > 0 && data[0] >= 0x80 && data[0] < 0xF0)
+                outputArbiter.channel_event (samplePosition);
+
+            receiveMidi (data, size);
+        }
+    }
+
+    const double reservedFrom = sendTimeline (midiMessages, buffer.getNumSamples());
+    transmitQueued (midiMessages, buffer.getNumSamples(), reservedFrom);
+    commitOutput (midiMessages);
+
+    outputArbiter.end_block (buffer.getNumSamples());
+
+    if (noteStatsReset.exchange (0) != 0)
+        outputArbiter.reset_stats();
+
+    noteEventCount = (int) outputArbiter.events();
+    lateNoteEventCount = (int) outputArbiter.late_events();
+    maxNoteLatencyUs = (int) (outputArbiter.max_latency() * 1.0e6);
+
+    if (loopbackEnabled.get() != 0)
+        runLoopback (midiMessages, buffer.getNumSamples());
+    else
+        loopbackRunning = false;
+
     // In case we have more outputs than inputs, this code clears any output
     // channels that didn't contain input data, (because these aren't
     // guaranteed to be empty - they may contain garbage).
@@ -155,6 +291,913 @@ void Sy22PanelAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffe
 
         // ..do something to the data...
     }
+
+    if (previewEnabled.get() != 0)
+    {
+        renderPreview (buffer, midiMessages);
+    }
+    else if (previewRunning)
+    {
+        previewSynth.all_notes_off();
+        previewRunning = false;
+    }
+}
+
+void Sy22PanelAudioProcessor::renderPreview (AudioSampleBuffer& buffer, const MidiBuffer& midiMessages)
+{
+    sy22::Voice voice;
+
+    while (previewVoiceQueue.pop (voice))
+        previewSynth.set_voice (voice);
+
+    previewRunning = true;
+
+    if (buffer.getNumChannels() == 0)
+        return;
+
+    float* left = buffer.getWritePointer (0);
+    float* right = buffer.getNumChannels() > 1 ? buffer.getWritePointer (1) : nullptr;
+    const int numSamples = buffer.getNumSamples();
+    int rendered = 0;
+
+    // Render up to each note event, so that notes start on their sample
+    MidiBuffer::Iterator it (midiMessages);
+    const uint8* data;
+    int size, samplePosition;
+
+    while (it.getNextEvent (data, size, samplePosition))
+    {
+        if (size < 3 || data[0] < 0x80 || data[0] >= 0xF0)
+            continue;
+
+        const int position = jlimit (rendered, numSamples, samplePosition);
+
+        if (position > rendered)
+        {
+            previewSynth.render (left + rendered, right != nullptr ? right + rendered : nullptr,
+                                 (std::size_t) (position - rendered));
+            rendered = position;
+        }
+
+        const int status = data[0] & 0xF0;
+
+        // Controllers from 120 on are All Sound Off, All Notes Off and
+        // the mode messages
+        if (status == 0x90)
+            previewSynth.note_on (data[1], data[2]);
+        else if (status == 0x80)
+            previewSynth.note_off (data[1]);
+        else if (status == 0xB0 && data[1] >= 120)
+            previewSynth.all_notes_off();
+    }
+
+    if (numSamples > rendered)
+        previewSynth.render (left + rendered, right != nullptr ? right + rendered : nullptr,
+                             (std::size_t) (numSamples - rendered));
+}
+
+void Sy22PanelAudioProcessor::receiveMidi (const uint8* data, int size)
+{
+    std::size_t offset = 0;
+    const bool sy35 = getModel() == sy22::model_sy35;
+
+    while (offset < static_cast<std::size_t> (size))
+    {
+        std::size_t consumed;
+        const sy22::SysExResults::Result result = sy35
+            ? sy35SysExParser.feed (data + offset, size - offset, consumed)
+            : sysExParser.feed (data + offset, size - offset, consumed);
+
+        // If the message thread has fallen behind, the voice is dropped
+        // rather than waited for
+        if (result == sy22::SysExResults::voice_received)
+            receiveQueue.push (sy35 ? sy35SysExParser.voice() : sysExParser.voice());
+
+        offset += consumed;
+    }
+}
+
+void Sy22PanelAudioProcessor::encodeDump (sy22::Model model, const sy22::Voice& voice, uint8* out)
+{
+    sy22::SingleVoiceDump& dump = *reinterpret_cast<sy22::SingleVoiceDump*> (out);
+
+    if (model == sy22::model_sy35)
+        sy22::encode_svd<sy22::Sy35Model> (voice, dump);
+    else
+        sy22::encode_svd<sy22::Sy22Model> (voice, dump);
+}
+
+void Sy22PanelAudioProcessor::encodeDumpRequest (sy22::Model model, uint8* out)
+{
+    sy22::DumpRequest& request = *reinterpret_cast<sy22::DumpRequest*> (out);
+
+    if (model == sy22::model_sy35)
+        request = sy22::make_dump_request<sy22::Sy35Model>();
+    else
+        request = sy22::make_dump_request<sy22::Sy22Model>();
+}
+
+void Sy22PanelAudioProcessor::runLoopback (MidiBuffer& midiMessages, int numSamples)
+{
+    if (! loopbackRunning)
+    {
+        loopbackDevice.reset();
+        loopbackDevice.reset_stats();
+        loopbackRunning = true;
+    }
+
+    // Everything we send, including what the host passes through
+    {
+        MidiBuffer::Iterator it (midiMessages);
+        const uint8* data;
+        int size, samplePosition;
+
+        while (it.getNextEvent (data, size, samplePosition))
+            loopbackDevice.receive (data, (std::size_t) size, samplePosition);
+    }
+
+    loopbackDevice.advance (numSamples);
+
+    // Answers arrive as if from the SY22 MIDI out
+    sy22::SingleVoiceDump answer;
+
+    while (loopbackDevice.answer (answer))
+        receiveMidi (reinterpret_cast<const uint8*> (&answer), sizeof (answer));
+
+    loopbackStatsQueue.push (loopbackDevice.stats());
+}
+
+void Sy22PanelAudioProcessor::timerCallback()
+{
+    bool changed = false;
+
+    recycleOutput();
+
+    while (loopbackStatsQueue.pop (loopbackStats)) {}
+
+    if (previewEnabled.get() != 0)
+    {
+        const std::uint64_t hash = sy22::content_hash (lastSentVoice);
+
+        if (hash != previewVoiceHash && previewVoiceQueue.push (lastSentVoice))
+            previewVoiceHash = hash;
+    }
+
+    sy22::Voice scheduledVoice;
+
+    while (scheduledSentQueue.pop (scheduledVoice))
+    {
+        lastSentVoice = scheduledVoice;
+        hasSentVoice = true;
+        refreshParameters();
+    }
+
+    while (receiveQueue.pop (receivedVoice))
+    {
+        if (bankUpload.active()
+             && bankUpload.received (receivedVoice, Time::getMillisecondCounterHiRes() / 1000.0))
+            continue;
+
+        changed = true;
+
+        // A pause ends any bank transfer, the next voice starts afresh
+        const uint32 now = Time::getMillisecondCounter();
+
+        if (now - lastVoiceReceivedMs > (uint32) bankPauseMs)
+            bankReceiver.reset();
+
+        lastVoiceReceivedMs = now;
+
+        if (bankReceiver.add (receivedVoice))
+        {
+            std::copy (bankReceiver.voices(), bankReceiver.voices() + sy22::bank_voices,
+                       receivedBank);
+            hasReceivedBank = true;
+        }
+    }
+
+    if (changed)
+        sendChangeMessage();
+
+    sendHostProgram();
+    pumpUpload();
+    flushParameters();
+}
+
+void Sy22PanelAudioProcessor::sendHostProgram()
+{
+    if (hostProgramPending.exchange (0) == 0)
+        return;
+
+    const int index = hostProgram.get();
+
+    if (! isPositiveAndBelow (index, getNumPrograms()))
+        return;
+
+    TransmitEntry* entry = prepareTransmit();
+
+    // Queue full, try again on the next tick
+    if (entry == nullptr)
+    {
+        hostProgramPending = 1;
+        return;
+    }
+
+    // Already encoded and checksummed, only a copy into the pool slot.
+    // Both models share the header the bank is encoded with.
+    std::memcpy (entry->data, &bankOf (index).dump (slotOf (index)), sizeof (sy22::SingleVoiceDump));
+    commitTransmit (sizeof (sy22::SingleVoiceDump), true);
+
+    currentProgram = index;
+    lastSentVoice = bankOf (index).voice (slotOf (index));
+    hasSentVoice = true;
+    refreshParameters();
+}
+
+void Sy22PanelAudioProcessor::pumpUpload()
+{
+    if (! bankUpload.active())
+        return;
+
+    const double now = Time::getMillisecondCounterHiRes() / 1000.0;
+
+    // Whatever is queued goes out before our requests do
+    if (commandQueue.size() > 0)
+        bankUpload.hold (now);
+    else
+        bankUpload.update (now);
+
+    // Program Change, dump and request of a voice go in together
+    std::size_t memory;
+    bool sent = false;
+    const sy22::Model dumpModel = getModel();
+
+    while (transmitQueue.capacity() - transmitQueue.size() >= 3
+            && commandQueue.capacity() - commandQueue.size() >= 3
+            && bankUpload.next (memory, now))
+    {
+        const sy22::Voice& voice = bankUpload.voice (memory);
+
+        TransmitEntry* entry = prepareTransmit();
+        entry->data[0] = 0xC0;
+        entry->data[1] = static_cast<uint8> (memory);
+        commitTransmit (2, false);
+
+        entry = prepareTransmit();
+        encodeDump (dumpModel, voice, entry->data);
+        commitTransmit (sizeof (sy22::SingleVoiceDump), true);
+
+        entry = prepareTransmit();
+        encodeDumpRequest (dumpModel, entry->data);
+        commitTransmit (sizeof (sy22::DumpRequest), false);
+
+        lastSentVoice = voice;
+        hasSentVoice = true;
+        sent = true;
+    }
+
+    if (sent)
+        refreshParameters();
+}
+
+void Sy22PanelAudioProcessor::flushParameters()
+{
+    // Wire capacity of one timer interval. While earlier traffic is
+    // still queued nothing is sent, and automation keeps coalescing.
+    const int budget = sy22::TransmitScheduler::bytes_per_second * timerIntervalMs / 1000;
+
+    if (transmitQueuedBytes.get() > budget)
+        return;
+
+    const int maxFields = budget / (int) sizeof (sy22::ParameterChange);
+    sy22::Voice edited (lastSentVoice);
+    std::size_t fields[sy22::parameter_count];
+    int numFields = 0;
+
+    for (std::size_t i = 0; i < sy22::parameter_count; ++i)
+    {
+        const sy22::ParameterInfo& p = sy22::parameters[i];
+        bool newField = true;
+
+        for (int f = 0; f < numFields; ++f)
+            newField = newField && sy22::parameters[fields[f]].offset != p.offset;
+
+        if (newField && numFields == maxFields)
+            continue;
+
+        if (parameterDirty[i].exchange (0) == 0)
+            continue;
+
+        sy22::set_parameter (edited, p, parameterValues[i].get());
+
+        if (newField)
+            fields[numFields++] = i;
+    }
+
+    // Parameters sharing a field go out as one message
+    for (int f = 0; f < numFields; ++f)
+    {
+        const sy22::ParameterInfo& p = sy22::parameters[fields[f]];
+
+        if (! editVoice (p.offset, sy22::parameter_field (edited, p)))
+        {
+            // Queue full, try the rest again next time
+            for (int g = f; g < numFields; ++g)
+                for (std::size_t i = 0; i < sy22::parameter_count; ++i)
+                    if (sy22::parameters[i].offset == sy22::parameters[fields[g]].offset)
+                        parameterDirty[i] = 1;
+            break;
+        }
+    }
+}
+
+void Sy22PanelAudioProcessor::refreshParameters()
+{
+    // Follow voice changes made some other way than automation, without
+    // overriding automation that hasn't been sent yet
+    for (std::size_t i = 0; i < sy22::parameter_count; ++i)
+    {
+        const int value = sy22::get_parameter (lastSentVoice, sy22::parameters[i]);
+
+        if (parameterDirty[i].get() == 0 && parameterValues[i].get() != value)
+        {
+            parameterValues[i] = value;
+            sendParamChangeMessageToListeners ((int) i, sy22::to_normalized (sy22::parameters[i], value));
+        }
+    }
+}
+
+const sy22::Voice& Sy22PanelAudioProcessor::getReceivedVoice() const
+{
+    return receivedVoice;
+}
+
+const sy22::Voice* Sy22PanelAudioProcessor::getReceivedBank() const
+{
+    return hasReceivedBank ? receivedBank : nullptr;
+}
+
+double Sy22PanelAudioProcessor::sendTimeline (MidiBuffer& midiMessages, int numSamples)
+{
+    const double nothingReserved = std::numeric_limits<double>::max();
+
+    while (const ScheduledDump* scheduled = scheduleQueue.front())
+    {
+        unsigned slot;
+
+        if (timeline.add (scheduled->beat, sizeof (sy22::SingleVoiceDump), slot))
+            std::memcpy (timelineDumps[slot], scheduled->data, sizeof (sy22::SingleVoiceDump));
+        else
+            ++missedVoiceChanges;
+
+        scheduleQueue.pop();
+    }
+
+    if (timeline.size() == 0)
+        return nothingReserved;
+
+    // Nothing is due while the transport stands still
+    AudioPlayHead* const playHead = getPlayHead();
+    AudioPlayHead::CurrentPositionInfo position;
+    const double sampleRate = getSampleRate();
+
+    if (playHead == nullptr || ! playHead->getCurrentPosition (position)
+         || ! position.isPlaying || position.bpm <= 0.0 || sampleRate <= 0.0)
+        return nothingReserved;
+
+    const double samplesPerBeat = sampleRate * 60.0 / position.bpm;
+    const double samplesPerByte = transmitScheduler.duration_samples (1, false);
+
+    while (const sy22::Timeline::Event* event = timeline.next())
+    {
+        const double target = sy22::Timeline::target (*event, position.ppqPosition, samplesPerBeat);
+
+        if (target < 0.0)
+        {
+            ++missedVoiceChanges;
+            timeline.pop();
+            continue;
+        }
+
+        const double start = sy22::Timeline::start (*event, position.ppqPosition,
+                                                     samplesPerBeat, samplesPerByte);
+
+        // Due in a later block, other traffic has to be done by then
+        if (start >= numSamples)
+            return start;
+
+        const long slot = transmitScheduler.next_slot (numSamples);
+
+        if (slot < 0)
+            return 0.0;
+
+        // Not before its pre-roll start, or the voice changes early
+        const long at = jmax (slot, (long) std::ceil (start));
+
+        if (at >= numSamples)
+            return start;
+
+        const uint8* data = timelineDumps[event->slot];
+        const int size = (int) event->size;
+        MidiBuffer* const output = stageOutput (midiMessages, size);
+
+        if (output == nullptr)
+            return 0.0;
+
+        const double lateness = at + event->size * samplesPerByte - target;
+
+        if (lateness >= 1.0)
+        {
+            ++lateVoiceChanges;
+            const int us = (int) (lateness * 1.0e6 / sampleRate);
+
+            if (us > worstLatenessUs.get())
+                worstLatenessUs = us;
+        }
+
+        // Has a deadline of its own, so it isn't arbitrated, only
+        // accounted for
+        output->addEvent (data, size, (int) at);
+        transmitScheduler.sent (at, event->size, true);
+        outputArbiter.sent (at, event->size * samplesPerByte);
+
+        scheduledSentQueue.push (reinterpret_cast<const sy22::SingleVoiceDump*> (data)->voice_data);
+        timeline.pop();
+    }
+
+    return nothingReserved;
+}
+
+void Sy22PanelAudioProcessor::transmitQueued (MidiBuffer& midiMessages, int numSamples,
+                                              double reservedFrom)
+{
+    // Hosts happily send everything in one block, which overflows the
+    // SY22 input. Instead give each dump its wire time and the device
+    // its processing gap before the next one goes out. Everything goes
+    // out one SysEx message at a time, so that the host's channel
+    // messages can be fitted in between.
+    while (const Command* command = commandQueue.front())
+    {
+        const uint8* unit;
+        int unitSize;
+        bool lastUnit = true;
+        bool gap = false;
+        sy22::ParameterChange change;
+
+        if (command->type == Command::editField)
+        {
+            change = sy22::make_parameter_change (0, command->offset, command->value);
+            unit = reinterpret_cast<const uint8*> (&change);
+            unitSize = sizeof (change);
+        }
+        else
+        {
+            // Parameter change bursts hold several messages back to back
+            const TransmitEntry& entry = *transmitQueue.front();
+            int end = transmitEntryPos;
+            while (end < entry.size && entry.data[end++] != 0xF7) {}
+
+            unit = entry.data + transmitEntryPos;
+            unitSize = end - transmitEntryPos;
+            lastUnit = end >= entry.size;
+            gap = entry.isDump && lastUnit;
+        }
+
+        const long slot = transmitScheduler.next_slot (numSamples);
+
+        if (slot < 0)
+            break;
+
+        const double wireTime = transmitScheduler.duration_samples ((std::size_t) unitSize, false);
+        const long start = outputArbiter.place (slot, wireTime, numSamples);
+
+        if (start < 0)
+            break;
+
+        // Keep out of the way of a timeline dump that is about to start
+        if (start + transmitScheduler.duration_samples ((std::size_t) unitSize, gap) > reservedFrom)
+            break;
+
+        MidiBuffer* const output = stageOutput (midiMessages, unitSize);
+
+        if (output == nullptr)
+            break;
+
+        output->addEvent (unit, unitSize, static_cast<int> (start));
+        transmitScheduler.sent (start, (std::size_t) unitSize, gap);
+        outputArbiter.sent (start, wireTime);
+        transmitQueuedBytes -= unitSize;
+
+        if (command->type == Command::editField)
+        {
+            commandQueue.pop();
+            continue;
+        }
+
+        if (! lastUnit)
+        {
+            transmitEntryPos += unitSize;
+            continue;
+        }
+
+        if (transmitQueue.front()->isDump)
+            --transmitQueuedDumps;
+
+        transmitEntryPos = 0;
+        transmitQueue.pop();
+        commandQueue.pop();
+    }
+
+    transmitScheduler.advance (numSamples);
+    transmitBusyMs = static_cast<int> (transmitScheduler.busy() * 1000.0);
+}
+
+Sy22PanelAudioProcessor::TransmitEntry* Sy22PanelAudioProcessor::prepareTransmit()
+{
+    // Both queues need room, the command is what the audio thread sees
+    if (commandQueue.prepare_push() == nullptr)
+        return nullptr;
+
+    return transmitQueue.prepare_push();
+}
+
+void Sy22PanelAudioProcessor::commitTransmit (int size, bool isDump)
+{
+    TransmitEntry* entry = transmitQueue.prepare_push();
+    jassert (entry != nullptr && size <= (int) sizeof (entry->data));
+
+    entry->size = size;
+    entry->isDump = isDump;
+
+    commandQueue.prepare_push()->type = Command::transmit;
+
+    transmitQueuedBytes += size;
+
+    if (isDump)
+        ++transmitQueuedDumps;
+
+    // Payload first, the audio thread only looks at it once the
+    // command is visible
+    transmitQueue.commit_push();
+    commandQueue.commit_push();
+}
+
+bool Sy22PanelAudioProcessor::queueVoice (const sy22::Voice& voice)
+{
+    TransmitEntry* entry = prepareTransmit();
+
+    if (entry == nullptr)
+        return false;
+
+    // Encode straight into the pool slot
+    encodeDump (getModel(), voice, entry->data);
+    commitTransmit (sizeof (sy22::SingleVoiceDump), true);
+
+    lastSentVoice = voice;
+    hasSentVoice = true;
+    refreshParameters();
+    return true;
+}
+
+bool Sy22PanelAudioProcessor::queueBank (const sy22::Voice* voices)
+{
+    if (transmitQueue.capacity() - transmitQueue.size() < sy22::bank_voices
+         || commandQueue.capacity() - commandQueue.size() < sy22::bank_voices)
+        return false;
+
+    // Each voice is encoded and checksummed in one pass, straight into
+    // its pool slot
+    const sy22::Model dumpModel = getModel();
+
+    for (std::size_t i = 0; i < sy22::bank_voices; ++i)
+    {
+        TransmitEntry* entry = prepareTransmit();
+        jassert (entry != nullptr);
+
+        encodeDump (dumpModel, voices[i], entry->data);
+        commitTransmit (sizeof (sy22::SingleVoiceDump), true);
+    }
+
+    // Loading a bank leaves the edit buffer with the last voice
+    lastSentVoice = voices[sy22::bank_voices - 1];
+    hasSentVoice = true;
+    refreshParameters();
+    return true;
+}
+
+bool Sy22PanelAudioProcessor::uploadBank (const sy22::Voice* voices)
+{
+    if (bankUpload.active())
+        return false;
+
+    bankUpload.start (voices, sy22::bank_voices, uploadTimeoutMs / 1000.0);
+    pumpUpload();
+    return true;
+}
+
+void Sy22PanelAudioProcessor::cancelUpload()
+{
+    // Whatever is already queued still goes out
+    bankUpload.cancel();
+}
+
+bool Sy22PanelAudioProcessor::isUploading() const
+{
+    return bankUpload.active();
+}
+
+int Sy22PanelAudioProcessor::getUploadVerifiedCount() const
+{
+    return static_cast<int> (bankUpload.verified_count());
+}
+
+int Sy22PanelAudioProcessor::getUploadFailedCount() const
+{
+    return static_cast<int> (bankUpload.failed_count());
+}
+
+int Sy22PanelAudioProcessor::getUploadRetransmits() const
+{
+    return static_cast<int> (bankUpload.retransmits());
+}
+
+bool Sy22PanelAudioProcessor::sendVoice (const sy22::Voice& voice)
+{
+    if (! sendVoiceChanges (voice))
+        return false;
+
+    // The current program follows edits
+    bankOf (currentProgram).set_voice (slotOf (currentProgram), voice);
+    return true;
+}
+
+bool Sy22PanelAudioProcessor::sendVoiceChanges (const sy22::Voice& voice)
+{
+    if (! hasSentVoice)
+        return queueVoice (voice);
+
+    TransmitEntry* entry = prepareTransmit();
+
+    if (entry == nullptr)
+        return false;
+
+    const std::size_t count = sy22::diff (lastSentVoice, voice, 0,
+                                          reinterpret_cast<sy22::ParameterChange*> (entry->data));
+
+    if (count == sy22::full_dump)
+        return queueVoice (voice);
+
+    if (count > 0)
+        commitTransmit (static_cast<int> (count * sizeof (sy22::ParameterChange)), false);
+
+    lastSentVoice = voice;
+    refreshParameters();
+    return true;
+}
+
+MidiBuffer* Sy22PanelAudioProcessor::stageOutput (const MidiBuffer& midiMessages, int numBytes)
+{
+    // A MidiBuffer event is a sample position and a size, then the data
+    const int eventBytes = numBytes + (int) (sizeof (int32) + sizeof (uint16));
+
+    // The first message of a block takes a free buffer and copies the
+    // host's events over, which has to fit along with ours
+    if (stagedOutput == nullptr)
+    {
+        if (midiMessages.data.size() + eventBytes > outputBufferBytes
+             || ! freeOutputQueue.pop (stagedOutput))
+        {
+            outputStalled = true;
+            return nullptr;
+        }
+
+        stagedOutput->clear();
+
+        MidiBuffer::Iterator it (midiMessages);
+        const uint8* data;
+        int size, samplePosition;
+
+        while (it.getNextEvent (data, size, samplePosition))
+            stagedOutput->addEvent (data, size, samplePosition);
+    }
+
+    // Full for this block, the rest goes in the next
+    if (stagedOutput->data.size() + eventBytes > outputBufferBytes)
+        return nullptr;
+
+    return stagedOutput;
+}
+
+void Sy22PanelAudioProcessor::commitOutput (MidiBuffer& midiMessages)
+{
+    if (outputStalled)
+    {
+        ++outputStalls;
+        outputStalled = false;
+    }
+
+    if (stagedOutput == nullptr)
+        return;
+
+    // Never full, it has room for every buffer there is
+    midiMessages.swapWith (*stagedOutput);
+    usedOutputQueue.push (stagedOutput);
+    stagedOutput = nullptr;
+}
+
+void Sy22PanelAudioProcessor::recycleOutput()
+{
+    MidiBuffer* buffer;
+
+    // Storage handed back by the host may be any size
+    while (usedOutputQueue.pop (buffer))
+    {
+        buffer->clear();
+        buffer->ensureSize (outputBufferBytes);
+        freeOutputQueue.push (buffer);
+    }
+}
+
+int Sy22PanelAudioProcessor::getOutputStallCount() const
+{
+    return outputStalls.get();
+}
+
+int Sy22PanelAudioProcessor::getAudioAllocationCount() const
+{
+    return (int) sy22::scoped_allocations();
+}
+
+bool Sy22PanelAudioProcessor::editVoice (std::size_t offset, midi::byte_t value)
+{
+    // Fields with an overflow byte are addressed by it
+    if (offset >= offsetof (sy22::Voice, null)
+         || (offset > 0 && sy22::is_overflow_byte (offset - 1)))
+    {
+        jassertfalse;
+        return false;
+    }
+
+    Command* command = commandQueue.prepare_push();
+
+    if (command == nullptr)
+        return false;
+
+    uint8* data = reinterpret_cast<uint8*> (&lastSentVoice);
+
+    sy22::ProgramBank& bank = bankOf (currentProgram);
+    const std::size_t program = slotOf (currentProgram);
+
+    if (sy22::is_overflow_byte (offset))
+    {
+        lastSentVoice.set (reinterpret_cast<midi::byte_t&> (data[offset]), value);
+        bank.set_byte (program, offset, value.msb);
+        bank.set_byte (program, offset + 1, value.lsb);
+    }
+    else
+    {
+        value.msb = 0;
+        lastSentVoice.set (data[offset], value.lsb);
+        bank.set_byte (program, offset, value.lsb);
+    }
+
+    command->type = Command::editField;
+    command->offset = static_cast<uint16> (offset);
+    command->value = value;
+
+    transmitQueuedBytes += sizeof (sy22::ParameterChange);
+    commandQueue.commit_push();
+
+    refreshParameters();
+    return true;
+}
+
+const sy22::Voice& Sy22PanelAudioProcessor::getLastSentVoice() const
+{
+    return lastSentVoice;
+}
+
+bool Sy22PanelAudioProcessor::scheduleVoice (const sy22::Voice& voice, double ppq)
+{
+    ScheduledDump* scheduled = scheduleQueue.prepare_push();
+
+    if (scheduled == nullptr)
+        return false;
+
+    scheduled->beat = ppq;
+    encodeDump (getModel(), voice, scheduled->data);
+    scheduleQueue.commit_push();
+    return true;
+}
+
+bool Sy22PanelAudioProcessor::scheduleProgram (int program, double ppq)
+{
+    if (! isPositiveAndBelow (program, getNumPrograms()))
+        return false;
+
+    ScheduledDump* scheduled = scheduleQueue.prepare_push();
+
+    if (scheduled == nullptr)
+        return false;
+
+    scheduled->beat = ppq;
+    // Cached dump, its header is the same for both models
+    std::memcpy (scheduled->data, &bankOf (program).dump (slotOf (program)),
+                 sizeof (sy22::SingleVoiceDump));
+    scheduleQueue.commit_push();
+    return true;
+}
+
+void Sy22PanelAudioProcessor::setNoteLatencyBoundMs (double ms)
+{
+    noteLatencyBoundUs = (int) (jmax (0.0, ms) * 1000.0);
+}
+
+double Sy22PanelAudioProcessor::getNoteLatencyBoundMs() const
+{
+    return noteLatencyBoundUs.get() / 1000.0;
+}
+
+int Sy22PanelAudioProcessor::getNoteEventCount() const
+{
+    return noteEventCount.get();
+}
+
+int Sy22PanelAudioProcessor::getLateNoteEventCount() const
+{
+    return lateNoteEventCount.get();
+}
+
+double Sy22PanelAudioProcessor::getMaxNoteLatencyMs() const
+{
+    return maxNoteLatencyUs.get() / 1000.0;
+}
+
+void Sy22PanelAudioProcessor::resetNoteLatencyStats()
+{
+    noteStatsReset = 1;
+}
+
+int Sy22PanelAudioProcessor::getLateVoiceChanges() const
+{
+    return lateVoiceChanges.get();
+}
+
+double Sy22PanelAudioProcessor::getWorstLatenessMs() const
+{
+    return worstLatenessUs.get() / 1000.0;
+}
+
+int Sy22PanelAudioProcessor::getMissedVoiceChanges() const
+{
+    return missedVoiceChanges.get();
+}
+
+void Sy22PanelAudioProcessor::setPreviewEnabled (bool enabled)
+{
+    previewEnabled = enabled ? 1 : 0;
+}
+
+bool Sy22PanelAudioProcessor::isPreviewEnabled() const
+{
+    return previewEnabled.get() != 0;
+}
+
+void Sy22PanelAudioProcessor::setModel (sy22::Model newModel)
+{
+    model = newModel;
+}
+
+sy22::Model Sy22PanelAudioProcessor::getModel() const
+{
+    return model.get() == sy22::model_sy35 ? sy22::model_sy35 : sy22::model_sy22;
+}
+
+void Sy22PanelAudioProcessor::setLoopbackDevice (bool enabled)
+{
+    loopbackEnabled = enabled ? 1 : 0;
+}
+
+bool Sy22PanelAudioProcessor::isLoopbackDevice() const
+{
+    return loopbackEnabled.get() != 0;
+}
+
+const sy22::SimulatedDevice::Stats& Sy22PanelAudioProcessor::getLoopbackStats() const
+{
+    return loopbackStats;
+}
+
+int Sy22PanelAudioProcessor::getTransmitQueueDepth() const
+{
+    return static_cast<int> (commandQueue.size());
+}
+
+double Sy22PanelAudioProcessor::getTransmitEta() const
+{
+    return transmitScheduler.duration (transmitQueuedBytes.get(), false)
+            + transmitScheduler.duration (0) * transmitQueuedDumps.get()
+            + transmitBusyMs.get() / 1000.0;
 }
 
 //==============================================================================
@@ -171,15 +1214,47 @@ AudioProcessorEditor* Sy22PanelAudioProcessor::createEditor()
 //==============================================================================
 void Sy22PanelAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // Program banks are stored as the dumps they already are
+    const int numBanks = programBanks.size();
+
+    destData.setSize (sy22::state_size ((std::size_t) numBanks));
+    uint8* state = static_cast<uint8*> (destData.getData());
+
+    sy22::write_state_header (state, (uint32) numBanks, (uint32) hostProgram.get(), getModel());
+
+    for (int i = 0; i < numBanks; ++i)
+        std::memcpy (sy22::state_bank (state, (std::size_t) i), &programBanks.getUnchecked (i)->dumps(),
+                     sizeof (sy22::BankDump));
 }
 
 void Sy22PanelAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    sy22::StateInfo info;
+
+    // Anything broken leaves the current programs alone
+    if (sizeInBytes <= 0
+         || ! sy22::read_state (static_cast<const uint8*> (data), (std::size_t) sizeInBytes, info)
+         || info.banks == 0)
+        return;
+
+    programBanks.clear();
+
+    for (uint32 i = 0; i < info.banks; ++i)
+    {
+        sy22::ProgramBank* bank = new sy22::ProgramBank();
+        bank->set_dumps (info.bank_data + i * sizeof (sy22::BankDump));
+        programBanks.add (bank);
+    }
+
+    currentProgram = isPositiveAndBelow ((int) info.current_program, getNumPrograms())
+                       ? (int) info.current_program : 0;
+    hostProgram = currentProgram;
+    hostProgramPending = 0;
+    setModel (info.model);
+
+    // Whatever the SY22 holds now is unknown
+    hasSentVoice = false;
+    updateHostDisplay();
 }
 
 //==============================================================================
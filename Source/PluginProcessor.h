@@ -12,12 +12,28 @@
 #define PLUGINPROCESSOR_H_INCLUDED
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "AllocationCounter.h"
+#include "Sy22.h"
+#include "BankUpload.h"
+#include "OutputArbiter.h"
+#include "PreviewSynth.h"
+#include "ProgramBank.h"
+#include "SavedState.h"
+#include "SimulatedDevice.h"
+#include "SpscQueue.h"
+#include "SysExParser.h"
+#include "Timeline.h"
+#include "TransmitScheduler.h"
+#include "VoiceDiff.h"
+#include "VoiceParameters.h"
 
 
 //==============================================================================
 /**
 */
-class Sy22PanelAudioProcessor  : public AudioProcessor
+class Sy22PanelAudioProcessor  : public AudioProcessor,
+                                 public ChangeBroadcaster,
+                                 private Timer
 {
 public:
     //==============================================================================
@@ -65,8 +81,325 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    //==============================================================================
+    /** Voice most recently received from the SY22. Message thread only,
+        listeners get a change message when it is updated.
+    */
+    const sy22::Voice& getReceivedVoice() const;
+
+    /** Bank most recently received from the SY22, sy22::bank_voices
+        voices, or nullptr if none has been. Message thread only.
+    */
+    const sy22::Voice* getReceivedBank() const;
+
+    /** Queue a voice for sending to the SY22. Dumps are paced to what
+        the MIDI wire and the device can take, so a large number can be
+        queued at once. Returns false if the queue is full.
+    */
+    bool queueVoice (const sy22::Voice& voice);
+
+    /** Queue a whole bank, sy22::bank_voices voices, for sending to the
+        SY22. Either all voices are queued or, if there isn't room,
+        none.
+    */
+    bool queueBank (const sy22::Voice* voices);
+
+    /** Upload a bank, sy22::bank_voices voices, to the SY22 voice
+        memory and read every voice back to check it arrived intact.
+        Voices that didn't are sent again. Needs the SY22 MIDI out
+        connected to our input. Returns false if an upload is already
+        running.
+    */
+    bool uploadBank (const sy22::Voice* voices);
+    void cancelUpload();
+    bool isUploading() const;
+
+    /** Voices of the last upload read back intact, voices given up on
+        after sy22::BankUpload::max_attempts sends, and sends repeated.
+        Message thread only.
+    */
+    int getUploadVerifiedCount() const;
+    int getUploadFailedCount() const;
+    int getUploadRetransmits() const;
+
+    /** Number of banks offered to the host as programs, each with
+        sy22::bank_voices programs.
+    */
+    int getNumProgramBanks() const;
+
+    /** Replace the voices of a program bank, sy22::bank_voices of them.
+        Passing getNumProgramBanks() as bank adds a new one.
+    */
+    void setProgramBank (int bank, const sy22::Voice* voices);
+
+    /** Voice of host program index. Message thread only. */
+    const sy22::Voice& getProgramVoice (int index) const;
+
+    /** Send an edited voice to the SY22. Only the fields that differ
+        from the voice last sent go out as parameter changes, unless a
+        full dump takes fewer bytes.
+    */
+    bool sendVoice (const sy22::Voice& voice);
+
+    /** Change a single field of the voice on the SY22, given as offset
+        in Voice data. For fields without an overflow byte only the LSB
+        of value is used. Safe to call for every knob movement, nothing
+        blocks or allocates.
+    */
+    bool editVoice (std::size_t offset, midi::byte_t value);
+
+    /** Voice the SY22 edit buffer holds once everything queued has been
+        sent. Message thread only.
+    */
+    const sy22::Voice& getLastSentVoice() const;
+
+    /** Send a voice so that it has fully arrived at the SY22 by song
+        position ppq, in quarter notes. Sending starts early by the wire
+        time of the dump, and other queued traffic is held back to keep
+        the wire free for it. Only happens while the host is playing.
+    */
+    bool scheduleVoice (const sy22::Voice& voice, double ppq);
+
+    /** The same for a host program, without encoding. */
+    bool scheduleProgram (int program, double ppq);
+
+    /** Scheduled voices that finished arriving after their position,
+        and the worst lateness so far.
+    */
+    int getLateVoiceChanges() const;
+    double getWorstLatenessMs() const;
+
+    /** Scheduled voices dropped because their position had already
+        passed, e.g. after the transport jumped.
+    */
+    int getMissedVoiceChanges() const;
+
+    /** Upper bound on the delay bulk SysEx may add to the host's note
+        and controller messages. Bulk data is sent a message at a time
+        in the gaps between them.
+    */
+    void setNoteLatencyBoundMs (double ms);
+    double getNoteLatencyBoundMs() const;
+
+    /** Channel messages passed through, how many were delayed beyond
+        the bound, and the worst delay seen, since the last reset.
+    */
+    int getNoteEventCount() const;
+    int getLateNoteEventCount() const;
+    double getMaxNoteLatencyMs() const;
+    void resetNoteLatencyStats();
+
+    /** Play the voice the SY22 edit buffer holds on a rough software
+        engine, from the host's notes, to audition edits without the
+        keyboard.
+    */
+    void setPreviewEnabled (bool enabled);
+    bool isPreviewEnabled() const;
+
+    /** Model of the synth this instance talks to. Dumps sent, requests
+        and dumps accepted are those of the model. Saved with the state.
+    */
+    void setModel (sy22::Model model);
+    sy22::Model getModel() const;
+
+    /** Feed our MIDI output to a simulated SY22 and its answers back to
+        our input, so that throughput, latency and drops can be measured
+        without the hardware. Output to the host is unchanged. Enabling
+        starts from a fresh device.
+    */
+    void setLoopbackDevice (bool enabled);
+    bool isLoopbackDevice() const;
+
+    /** What the simulated SY22 has seen, as of the last timer tick.
+        Message thread only.
+    */
+    const sy22::SimulatedDevice::Stats& getLoopbackStats() const;
+
+    /** Number of voice dumps, parameter change bursts and edits waiting
+        to be sent.
+    */
+    int getTransmitQueueDepth() const;
+
+    /** Estimated seconds until all queued voices have been sent. */
+    double getTransmitEta() const;
+
+    /** Blocks whose SysEx output had to wait for a later one because no
+        preallocated output buffer was ready. The audio thread never
+        grows a MidiBuffer itself, so instead of allocating it waits.
+    */
+    int getOutputStallCount() const;
+
+    /** Heap allocations made inside processBlock, by any instance. Only
+        debug builds count them, release builds always return 0.
+    */
+    int getAudioAllocationCount() const;
+
 private:
     //==============================================================================
+    void receiveMidi (const uint8* data, int size);
+    static void encodeDump (sy22::Model model, const sy22::Voice& voice, uint8* out);
+    static void encodeDumpRequest (sy22::Model model, uint8* out);
+    struct TransmitEntry;
+    TransmitEntry* prepareTransmit();
+    void commitTransmit (int size, bool isDump);
+    bool sendVoiceChanges (const sy22::Voice& voice);
+    sy22::ProgramBank& bankOf (int program) const;
+    static std::size_t slotOf (int program);
+    double sendTimeline (MidiBuffer& midiMessages, int numSamples);
+    void transmitQueued (MidiBuffer& midiMessages, int numSamples, double reservedFrom);
+    MidiBuffer* stageOutput (const MidiBuffer& midiMessages, int numBytes);
+    void commitOutput (MidiBuffer& midiMessages);
+    void recycleOutput();
+    void timerCallback() override;
+    void flushParameters();
+    void refreshParameters();
+    void sendHostProgram();
+    void pumpUpload();
+    void runLoopback (MidiBuffer& midiMessages, int numSamples);
+    void renderPreview (AudioSampleBuffer& buffer, const MidiBuffer& midiMessages);
+
+    // Codecs are compiled for each model, this picks one per message
+    Atomic<int> model;
+
+    // Audio thread receive state, no allocations allowed. Only the
+    // parser of the current model is fed.
+    sy22::SysExParser sysExParser;
+    sy22::Sy35SysExParser sy35SysExParser;
+
+    // Voices handed from the audio thread to the message thread
+    sy22::SpscQueue<sy22::Voice, 8> receiveQueue;
+
+    sy22::Voice receivedVoice;
+
+    // Voices arriving closer together than this belong to one bank dump
+    enum { bankPauseMs = 1000 };
+    sy22::BankReceiver bankReceiver;
+    uint32 lastVoiceReceivedMs;
+    sy22::Voice receivedBank[sy22::bank_voices];
+    bool hasReceivedBank;
+
+    // Commands from the message thread to the audio thread. Everything
+    // goes through here so that edits and dumps reach the SY22 in the
+    // order they were made; bulk data waits in transmitQueue.
+    struct Command
+    {
+        enum Type
+        {
+            // Send the oldest transmitQueue entry
+            transmit,
+            // Send a parameter change for a single field
+            editField
+        };
+
+        uint8 type;
+        uint16 offset;
+        midi::byte_t value;
+    };
+
+    // Pool of pre-sized SysEx buffers, encoded into in place on the
+    // message thread. Holds a voice dump, or a burst of parameter change
+    // messages.
+    struct TransmitEntry
+    {
+        int size;
+        // Device needs its processing gap after this one
+        bool isDump;
+        uint8 data[sizeof (sy22::SingleVoiceDump)];
+    };
+
+    sy22::SpscQueue<Command, 256> commandQueue;
+    sy22::SpscQueue<TransmitEntry, 128> transmitQueue;
+    sy22::TransmitScheduler transmitScheduler;
+
+    // Voice changes locked to song position. Dumps are handed to the
+    // audio thread, which keeps them in beat order until they are due.
+    struct ScheduledDump
+    {
+        double beat;
+        uint8 data[sizeof (sy22::SingleVoiceDump)];
+    };
+
+    sy22::SpscQueue<ScheduledDump, 16> scheduleQueue;
+    sy22::Timeline timeline;
+    uint8 timelineDumps[sy22::Timeline::capacity][sizeof (sy22::SingleVoiceDump)];
+    // Scheduled voices that went out, for lastSentVoice
+    sy22::SpscQueue<sy22::Voice, 16> scheduledSentQueue;
+    Atomic<int> lateVoiceChanges;
+    Atomic<int> missedVoiceChanges;
+    Atomic<int> worstLatenessUs;
+    Atomic<int> transmitBusyMs;
+    Atomic<int> transmitQueuedBytes;
+    Atomic<int> transmitQueuedDumps;
+    // Read position in the front transmitQueue entry, which goes out a
+    // message at a time. Audio thread only.
+    int transmitEntryPos;
+
+    // Channel messages get the wire first
+    sy22::OutputArbiter outputArbiter;
+    Atomic<int> noteLatencyBoundUs;
+    Atomic<int> noteStatsReset;
+    Atomic<int> noteEventCount;
+    Atomic<int> lateNoteEventCount;
+    Atomic<int> maxNoteLatencyUs;
+
+    // Software preview of lastSentVoice. The timer hands over the voice
+    // whenever it changes.
+    sy22::PreviewSynth previewSynth;
+    Atomic<int> previewEnabled;
+    bool previewRunning;
+    sy22::SpscQueue<sy22::Voice, 4> previewVoiceQueue;
+    std::uint64_t previewVoiceHash;
+
+    // Simulated SY22 on the far end of our output. Audio thread only,
+    // statistics go to the message thread once a block.
+    sy22::SimulatedDevice loopbackDevice;
+    Atomic<int> loopbackEnabled;
+    bool loopbackRunning;
+    sy22::SpscQueue<sy22::SimulatedDevice::Stats, 4> loopbackStatsQueue;
+    sy22::SimulatedDevice::Stats loopbackStats;
+
+    // Output of a block is built in one of these, sized up front, and
+    // swapped into the host's buffer. The storage the host had comes
+    // back in exchange, and the timer grows it before it is used again,
+    // so the audio thread never allocates for output. Only blocks that
+    // send something use one.
+    enum { numOutputBuffers = 32, outputBufferBytes = 8192 };
+    MidiBuffer outputBuffers[numOutputBuffers];
+    sy22::SpscQueue<MidiBuffer*, numOutputBuffers> freeOutputQueue;
+    sy22::SpscQueue<MidiBuffer*, numOutputBuffers> usedOutputQueue;
+    MidiBuffer* stagedOutput;
+    bool outputStalled;
+    Atomic<int> outputStalls;
+
+    // What the SY22 edit buffer holds once the queue has drained.
+    // Message thread only.
+    sy22::Voice lastSentVoice;
+    bool hasSentVoice;
+
+    // Verified bank upload, driven by the timer. Read-back answers are
+    // taken out of the receive queue while it runs.
+    enum { uploadTimeoutMs = 2000 };
+    sy22::BankUpload bankUpload;
+
+    // Host programs, kept encoded so a program change is only a copy.
+    // Edits of the current voice are mirrored into its dump. Always at
+    // least one bank.
+    OwnedArray<sy22::ProgramBank> programBanks;
+    int currentProgram;
+
+    // Host program changes. setCurrentProgram may come from any thread
+    // and only stores the program; the timer sends it and makes it
+    // current.
+    Atomic<int> hostProgram;
+    Atomic<int> hostProgramPending;
+
+    // Host automation. setParameter may come from any thread and only
+    // stores the value; the timer sends the latest value of each dirty
+    // field, within what the wire carries in one timer interval.
+    enum { timerIntervalMs = 50 };
+    Atomic<int> parameterValues[sy22::parameter_count];
+    Atomic<int> parameterDirty[sy22::parameter_count];
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Sy22PanelAudioProcessor)
 };
 
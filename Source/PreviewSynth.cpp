@@ -0,0 +1,652 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "PreviewSynth.h"
+#include "VoiceParams.h"
+
+namespace sy22 {
+
+	const std::size_t PreviewSynth::max_notes;
+	const std::size_t PreviewSynth::control_block;
+	const std::size_t PreviewSynth::elements;
+	const std::size_t PreviewSynth::lanes;
+
+	namespace {
+
+		// Quietest level an envelope reaches, and where a release ends
+		const float floor_db = -96.0f;
+		const float silent_db = -90.0f;
+		// Vector step lengths are counted in these, in seconds
+		const float vector_tick = 0.01f;
+		const int repeat_step = vector_step_repeat;
+		const int end_step = vector_step_end;
+		// Headroom for a dozen notes
+		const float output_gain = 0.25f;
+
+		int value(const midi::byte_t& b) {
+			return midi::Byte<int>(b);
+		}
+
+		// Offset signed fields, 174 is -12 and 140 -64
+		int signed_value(const midi::byte_t& b) {
+			return static_cast<signed char>(value(b) & 0xFF);
+		}
+
+		// Levels go from 0 loudest to 7F quietest
+		float attenuation_db(int level) {
+			return -0.75f * (level & 0x7F);
+		}
+
+		// Envelope rates go from 0 slowest to 63 instant
+		float rate_speed(int rate) {
+			rate = std::max(0, std::min(63, rate));
+			return 8.0f * std::pow(2.0f, rate / 4.5f);
+		}
+
+		float db_to_gain(float db) {
+			return db <= floor_db ? 0.0f : std::pow(10.0f, db / 20.0f);
+		}
+
+		// Sign and magnitude, in cents
+		float detune_cents(unsigned char temperament_detune) {
+			int d = temperament_detune & 0x07;
+			return (temperament_detune & 0x08 ? -d : d) * 1.5f;
+		}
+
+		// Pan 0 is right and 4 left, equal power in between
+		void pan_gains(unsigned char env_type_pan, float& left, float& right) {
+			int p = env_type_pan & 0x07;
+			float l = p > 4 ? 0.5f : p / 4.0f;
+			left = std::sqrt(l);
+			right = std::sqrt(1.0f - l);
+		}
+
+		float velocity_sensitivity(unsigned char response) {
+			return ((response >> 4) & 0x07) / 7.0f;
+		}
+
+		// Operator frequency field (X)WWWFFFF, F as harmonic
+		float harmonic(int frequency) {
+			int f = frequency & 0x0F;
+			return f ? static_cast<float>(f) : 0.5f;
+		}
+
+		// Vector X and Y, 0 to 3E for -31 to +31
+		float position(unsigned char c) {
+			return (std::min<int>(c, 0x3E) - 31) / 31.0f;
+		}
+
+		/**
+		 * sin(2 pi x) with x in cycles, a parabola refined to within
+		 * 0.1%, which is plenty for a preview.
+		 */
+		inline float sin_cycles(float x) {
+			x -= std::floor(x + 0.5f);
+			float y = 8.0f * (x - 2.0f * x * std::fabs(x));
+			return y + 0.225f * (y * std::fabs(y) - y);
+		}
+
+		inline float wrap(float x) {
+			return x - std::floor(x + 0.5f);
+		}
+
+#if defined(__SSE2__)
+		inline __m128 abs(__m128 x) {
+			return _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+		}
+
+		// Into -0.5 to 0.5, by rounding to nearest
+		inline __m128 wrap(__m128 x) {
+			return _mm_sub_ps(x, _mm_cvtepi32_ps(_mm_cvtps_epi32(x)));
+		}
+
+		inline __m128 sin_cycles(__m128 x) {
+			x = wrap(x);
+			__m128 y = _mm_mul_ps(_mm_set1_ps(8.0f), _mm_sub_ps(x,
+						_mm_mul_ps(_mm_set1_ps(2.0f), _mm_mul_ps(x, abs(x)))));
+			return _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(0.225f),
+						_mm_sub_ps(_mm_mul_ps(y, abs(y)), y)));
+		}
+
+		inline float hsum(__m128 v) {
+			__m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+			s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+			return _mm_cvtss_f32(s);
+		}
+#endif
+
+	};
+
+	PreviewSynth::PreviewSynth() :
+		sample_rate_(44100.0),
+		four_elements_(false),
+		count_(0),
+		age_(0) {
+		std::fill(modulator_phase_, modulator_phase_ + lanes, 0.0f);
+		std::fill(carrier_phase_, carrier_phase_ + lanes, 0.0f);
+		std::fill(modulator_inc_, modulator_inc_ + lanes, 0.0f);
+		std::fill(carrier_inc_, carrier_inc_ + lanes, 0.0f);
+		std::fill(index_, index_ + lanes, 0.0f);
+		std::fill(index_step_, index_step_ + lanes, 0.0f);
+		std::fill(amp_, amp_ + lanes, 0.0f);
+		std::fill(amp_step_, amp_step_ + lanes, 0.0f);
+		std::fill(feedback_, feedback_ + lanes, 0.0f);
+		std::fill(previous_, previous_ + lanes, 0.0f);
+		std::fill(gain_left_, gain_left_ + lanes, 0.0f);
+		std::fill(gain_right_, gain_right_ + lanes, 0.0f);
+		set_voice(make_voice());
+	}
+
+	void PreviewSynth::set_sample_rate(double sample_rate) {
+		if (sample_rate > 0.0) {
+			sample_rate_ = sample_rate;
+			for (std::size_t i = 0; i < count_; i++) {
+				tune(notes_[i]);
+			}
+		}
+	}
+
+	void PreviewSynth::decode_envelope(const Envelope& env, int env_type,
+			const Common& common, EnvelopePatch& out) {
+		// Organ type ignores the user envelope
+		if (((env_type >> 4) & 0x07) == 7) {
+			std::fill(out.level, out.level + 4, 0.0f);
+			std::fill(out.speed, out.speed + 4, rate_speed(63));
+			out.delay = 0.0f;
+			out.rate_scaling = 0.0f;
+			return;
+		}
+
+		out.level[0] = attenuation_db(env.il);
+		out.level[1] = attenuation_db(env.al);
+		out.level[2] = attenuation_db(env.dl1);
+		out.level[3] = attenuation_db(env.dl2);
+		out.speed[0] = rate_speed((env.delay_ar.lsb & 0x3F) + common.attack / 4);
+		out.speed[1] = rate_speed(env.peak_dr1.lsb & 0x3F);
+		out.speed[2] = rate_speed(env.dr2 & 0x3F);
+		out.speed[3] = rate_speed((env.rr & 0x3F) + common.release / 4);
+		out.delay = env.delay_ar.msb ? common.delay : 0.0f;
+		out.rate_scaling = (env.level_rate_scaling.lsb & 0x07) / 7.0f;
+	}
+
+	void PreviewSynth::decode_lfo(const LFO& lfo, ElementPatch& out) {
+		const int wave_speed = value(lfo.wave_speed);
+		out.lfo_wave = (wave_speed >> 5) & 0x07;
+		out.lfo_frequency = 0.1f * std::pow(2.0f, (wave_speed & 0x1F) / 4.0f);
+		out.lfo_delay = value(lfo.delay) * 0.01f;
+		out.lfo_fade = value(lfo.rate) * 0.01f;
+		out.am_depth = (lfo.am_depth & 0x0F) / 15.0f * 0.5f;
+		const float pm = (lfo.pm_depth & 0x1F) / 31.0f;
+		out.pm_depth = pm * pm * 200.0f;
+	}
+
+	void PreviewSynth::decode_element(const Wave& wave, const Common& common,
+			ElementPatch& out) {
+		out.enabled = true;
+		out.volume = attenuation_db(wave.tone_volume);
+		pan_gains(wave.env_type_pan, out.gain_left, out.gain_right);
+		out.pitch = static_cast<float>(signed_value(wave.pitch_shift));
+		out.detune = detune_cents(wave.temperament_detune);
+		// Without the wave ROM, wave numbers pick a brightness and ratio
+		out.ratio = static_cast<float>(1 + ((wave.wave >> 4) & 0x03));
+		out.fixed = 0.0f;
+		out.index = 0.05f + (wave.wave & 0x0F) * 0.05f;
+		out.feedback = 0.0f;
+		out.velocity = velocity_sensitivity(wave.velocity_after_touch_response);
+		decode_envelope(wave.env, wave.env_type_pan, common, out.amp);
+		out.mod = out.amp;
+		out.mod_envelope = false;
+		decode_lfo(wave.lfo, out);
+	}
+
+	void PreviewSynth::decode_element(const FM& fm, const Common& common,
+			ElementPatch& out) {
+		const int carrier = value(fm.carrier.fixed_waveform_freq);
+		const int modulator = value(fm.modulator.fixed_waveform_freq);
+
+		out.enabled = true;
+		out.volume = attenuation_db(fm.carrier.level);
+		pan_gains(fm.env_type_pan, out.gain_left, out.gain_right);
+		out.pitch = signed_value(fm.pitch_shift) +
+			12.0f * std::log2(harmonic(carrier));
+		out.detune = detune_cents(fm.carrier.temperament_detune);
+		out.ratio = harmonic(modulator) / harmonic(carrier);
+		out.fixed = carrier & 0x80 ? 55.0f * ((carrier & 0x0F) + 1) : 0.0f;
+		out.index = db_to_gain(attenuation_db(fm.modulator.level));
+		const int feedback = fm.feedback & 0x07;
+		out.feedback = feedback ? 0.25f * std::pow(2.0f, feedback - 7.0f) : 0.0f;
+		out.velocity = velocity_sensitivity(fm.velocity_after_touch_response);
+		decode_envelope(fm.carrier.env, fm.env_type_pan, common, out.amp);
+		decode_envelope(fm.modulator.env, fm.env_type_pan, common, out.mod);
+		out.mod_envelope = true;
+		decode_lfo(fm.lfo, out);
+	}
+
+	void PreviewSynth::set_voice(const Voice& v) {
+		Common common;
+		common.attack = signed_value(v.common_ar);
+		common.release = signed_value(v.common_rr);
+		common.delay = (v.env_delay & 0x7F) * 0.02f;
+
+		decode_element(v.A, common, patch_[0]);
+		decode_element(v.B, common, patch_[1]);
+		decode_element(v.C, common, patch_[2]);
+		decode_element(v.D, common, patch_[3]);
+
+		// (T)00PPPPP, T set for ABCD
+		four_elements_ = v.configuration_pitch_bend.msb != 0;
+		patch_[2].enabled = four_elements_;
+		patch_[3].enabled = four_elements_;
+		vector_ = v.vector;
+
+		for (std::size_t i = 0; i < count_; i++) {
+			tune(notes_[i]);
+		}
+	}
+
+	void PreviewSynth::tune(Note& note) {
+		for (std::size_t e = 0; e < elements; e++) {
+			const ElementPatch& p = patch_[e];
+			const float cents = (note.key - 69 + p.pitch) * 100.0f + p.detune;
+			const float frequency = p.fixed > 0.0f ? p.fixed :
+				440.0f * std::pow(2.0f, cents / 1200.0f);
+			note.carrier_inc[e] = static_cast<float>(frequency / sample_rate_);
+			note.modulator_inc[e] = note.carrier_inc[e] * p.ratio;
+			note.rate_scale[e] = std::pow(2.0f,
+					p.amp.rate_scaling * (note.key - 60) / 12.0f);
+		}
+	}
+
+	void PreviewSynth::note_on(int key, int velocity) {
+		if (velocity == 0) {
+			note_off(key);
+			return;
+		}
+
+		std::size_t slot = count_;
+		if (count_ < max_notes) {
+			count_++;
+		} else {
+			slot = 0;
+			for (std::size_t i = 1; i < count_; i++) {
+				if (notes_[i].age < notes_[slot].age) {
+					slot = i;
+				}
+			}
+		}
+		start(slot, key, velocity);
+	}
+
+	void PreviewSynth::note_off(int key) {
+		for (std::size_t i = 0; i < count_; i++) {
+			if (notes_[i].key == key) {
+				notes_[i].released = true;
+			}
+		}
+	}
+
+	void PreviewSynth::all_notes_off() {
+		while (count_ > 0) {
+			remove(count_ - 1);
+		}
+	}
+
+	void PreviewSynth::start(std::size_t slot, int key, int velocity) {
+		Note& note = notes_[slot];
+		note.key = key;
+		note.velocity = std::min(velocity, 127) / 127.0f;
+		note.released = false;
+		note.time = 0.0f;
+		note.age = age_++;
+		note.random = 22 + key;
+		note.vector_step = 0;
+		note.vector_time = 0.0f;
+
+		for (std::size_t e = 0; e < elements; e++) {
+			const EnvelopeState amp = {0, patch_[e].amp.level[0], 0.0f};
+			const EnvelopeState mod = {0, patch_[e].mod.level[0], 0.0f};
+			note.amp[e] = amp;
+			note.mod[e] = mod;
+			note.lfo_phase[e] = 0.0f;
+			note.lfo_hold[e] = 0.0f;
+
+			const std::size_t lane = e * max_notes + slot;
+			modulator_phase_[lane] = 0.0f;
+			carrier_phase_[lane] = 0.0f;
+			previous_[lane] = 0.0f;
+			index_[lane] = 0.0f;
+			index_step_[lane] = 0.0f;
+			amp_[lane] = 0.0f;
+			amp_step_[lane] = 0.0f;
+		}
+		tune(note);
+	}
+
+	void PreviewSynth::remove(std::size_t slot) {
+		const std::size_t last = --count_;
+
+		for (std::size_t e = 0; e < elements; e++) {
+			const std::size_t to = e * max_notes + slot;
+			const std::size_t from = e * max_notes + last;
+			if (to != from) {
+				modulator_phase_[to] = modulator_phase_[from];
+				carrier_phase_[to] = carrier_phase_[from];
+				modulator_inc_[to] = modulator_inc_[from];
+				carrier_inc_[to] = carrier_inc_[from];
+				index_[to] = index_[from];
+				index_step_[to] = index_step_[from];
+				amp_[to] = amp_[from];
+				amp_step_[to] = amp_step_[from];
+				feedback_[to] = feedback_[from];
+				previous_[to] = previous_[from];
+				gain_left_[to] = gain_left_[from];
+				gain_right_[to] = gain_right_[from];
+			}
+			// Lanes past the last note are rendered along, silently
+			amp_[from] = 0.0f;
+			amp_step_[from] = 0.0f;
+			index_step_[from] = 0.0f;
+		}
+
+		if (slot != last) {
+			notes_[slot] = notes_[last];
+		}
+	}
+
+	void PreviewSynth::advance(EnvelopeState& state, const EnvelopePatch& patch,
+			float rate_scale, bool released, float dt) {
+		// Stages: delay, attack, decay 1, decay 2 and sustain, release,
+		// done
+		if (released && state.stage < 4) {
+			state.stage = 4;
+		}
+
+		if (state.stage == 0) {
+			state.time += dt;
+			if (state.time < patch.delay) {
+				return;
+			}
+			state.stage = 1;
+		}
+
+		if (state.stage < 4) {
+			const float target = patch.level[state.stage];
+			const float step = patch.speed[state.stage - 1] * rate_scale * dt;
+			state.db = state.db < target ?
+				std::min(target, state.db + step) :
+				std::max(target, state.db - step);
+			if (state.db == target && state.stage < 3) {
+				state.stage++;
+			}
+		} else if (state.stage == 4) {
+			state.db -= patch.speed[3] * rate_scale * dt;
+			if (state.db <= silent_db) {
+				state.db = floor_db;
+				state.stage = 5;
+			}
+		}
+	}
+
+	void PreviewSynth::vector_weights(Note& note, float dt, float* weights) const {
+		const VectorStep* steps = vector_.level;
+		const std::size_t count = sizeof(vector_.level) / sizeof(vector_.level[0]);
+
+		// Empty steps pass at once, a repeat goes back to the first.
+		// Bounded, so that a loop of empty steps can't hang.
+		note.vector_time += dt;
+		for (std::size_t guard = 0; guard < count; guard++) {
+			const int len = value(steps[note.vector_step].len);
+			if (len == end_step) {
+				break;
+			}
+			if (len == repeat_step) {
+				note.vector_step = 0;
+				continue;
+			}
+			const float duration = len * vector_tick;
+			if (note.vector_time < duration) {
+				break;
+			}
+			if (note.vector_step + 1 == count) {
+				note.vector_time = duration;
+				break;
+			}
+			note.vector_time -= duration;
+			note.vector_step++;
+		}
+
+		// Glide from this step's position to the next one's
+		const VectorStep& from = steps[note.vector_step];
+		const int len = value(from.len);
+		float x = position(from.x);
+		float y = position(from.y);
+		if (len > 0 && len < repeat_step && note.vector_step + 1 < count) {
+			std::size_t next = note.vector_step + 1;
+			if (value(steps[next].len) == repeat_step) {
+				next = 0;
+			}
+			const float t = std::min(1.0f, note.vector_time / (len * vector_tick));
+			x += (position(steps[next].x) - x) * t;
+			y += (position(steps[next].y) - y) * t;
+		}
+
+		if (four_elements_) {
+			weights[0] = (1.0f - x) * (1.0f + y) * 0.25f;
+			weights[1] = (1.0f + x) * (1.0f + y) * 0.25f;
+			weights[2] = (1.0f - x) * (1.0f - y) * 0.25f;
+			weights[3] = (1.0f + x) * (1.0f - y) * 0.25f;
+		} else {
+			weights[0] = (1.0f - x) * 0.5f;
+			weights[1] = (1.0f + x) * 0.5f;
+			weights[2] = 0.0f;
+			weights[3] = 0.0f;
+		}
+	}
+
+	float PreviewSynth::lfo(Note& note, std::size_t e, float dt) {
+		const ElementPatch& p = patch_[e];
+		float& phase = note.lfo_phase[e];
+
+		phase += p.lfo_frequency * dt;
+		const bool wrapped = phase >= 1.0f;
+		phase -= std::floor(phase);
+
+		float v;
+		switch (p.lfo_wave) {
+		case 1:
+			// Saw down
+			v = 1.0f - 2.0f * phase;
+			break;
+		case 2:
+			v = phase < 0.5f ? 1.0f : -1.0f;
+			break;
+		case 3:
+			// Sample and hold
+			if (wrapped) {
+				note.random = note.random * 1664525u + 1013904223u;
+				note.lfo_hold[e] = (note.random >> 8) / 8388608.0f - 1.0f;
+			}
+			v = note.lfo_hold[e];
+			break;
+		default:
+			v = 4.0f * std::fabs(phase - 0.5f) - 1.0f;
+			break;
+		}
+
+		// Delay, then fade in
+		if (note.time < p.lfo_delay) {
+			return 0.0f;
+		}
+		if (p.lfo_fade > 0.0f) {
+			v *= std::min(1.0f, (note.time - p.lfo_delay) / p.lfo_fade);
+		}
+		return v;
+	}
+
+	void PreviewSynth::update(std::size_t n) {
+		const float dt = static_cast<float>(n / sample_rate_);
+
+		for (std::size_t i = 0; i < count_;) {
+			Note& note = notes_[i];
+			note.time += dt;
+
+			float weights[elements];
+			vector_weights(note, dt, weights);
+
+			bool sounding = false;
+			for (std::size_t e = 0; e < elements; e++) {
+				const ElementPatch& p = patch_[e];
+				const std::size_t lane = e * max_notes + i;
+
+				advance(note.amp[e], p.amp, note.rate_scale[e], note.released, dt);
+				float index = p.index;
+				if (p.mod_envelope) {
+					advance(note.mod[e], p.mod, note.rate_scale[e], note.released, dt);
+					index *= db_to_gain(note.mod[e].db);
+				}
+				sounding = sounding || (p.enabled && note.amp[e].stage != 5);
+
+				const float l = lfo(note, e, dt);
+				float amp = 0.0f;
+				if (p.enabled) {
+					amp = db_to_gain(note.amp[e].db + p.volume) * weights[e] *
+						(1.0f - p.velocity * (1.0f - note.velocity)) *
+						(1.0f - p.am_depth * (0.5f + 0.5f * l));
+				}
+				const float bend = std::pow(2.0f, p.pm_depth * l / 1200.0f);
+
+				carrier_inc_[lane] = note.carrier_inc[e] * bend;
+				modulator_inc_[lane] = note.modulator_inc[e] * bend;
+				amp_step_[lane] = (amp - amp_[lane]) / n;
+				index_step_[lane] = (index - index_[lane]) / n;
+				feedback_[lane] = p.feedback;
+				gain_left_[lane] = p.gain_left;
+				gain_right_[lane] = p.gain_right;
+			}
+
+			if (sounding) {
+				i++;
+			} else {
+				// The last note moves in here and is updated next
+				remove(i);
+			}
+		}
+	}
+
+	void PreviewSynth::synthesize(float* left, float* right, std::size_t n) {
+		const std::size_t groups = (count_ + 3) / 4;
+
+#if defined(__SSE2__)
+		__m128 mix_left[control_block];
+		__m128 mix_right[control_block];
+		std::fill(mix_left, mix_left + n, _mm_setzero_ps());
+		std::fill(mix_right, mix_right + n, _mm_setzero_ps());
+
+		// Four notes at a time, the same element of each
+		for (std::size_t e = 0; e < elements; e++) {
+			if (!patch_[e].enabled) {
+				continue;
+			}
+			for (std::size_t g = 0; g < groups; g++) {
+				const std::size_t lane = e * max_notes + g * 4;
+				__m128 modulator_phase = _mm_load_ps(modulator_phase_ + lane);
+				__m128 carrier_phase = _mm_load_ps(carrier_phase_ + lane);
+				const __m128 modulator_inc = _mm_load_ps(modulator_inc_ + lane);
+				const __m128 carrier_inc = _mm_load_ps(carrier_inc_ + lane);
+				__m128 index = _mm_load_ps(index_ + lane);
+				const __m128 index_step = _mm_load_ps(index_step_ + lane);
+				__m128 amp = _mm_load_ps(amp_ + lane);
+				const __m128 amp_step = _mm_load_ps(amp_step_ + lane);
+				const __m128 feedback = _mm_load_ps(feedback_ + lane);
+				__m128 previous = _mm_load_ps(previous_ + lane);
+				const __m128 gain_left = _mm_load_ps(gain_left_ + lane);
+				const __m128 gain_right = _mm_load_ps(gain_right_ + lane);
+
+				for (std::size_t s = 0; s < n; s++) {
+					previous = sin_cycles(_mm_add_ps(modulator_phase,
+								_mm_mul_ps(feedback, previous)));
+					__m128 out = _mm_mul_ps(amp, sin_cycles(_mm_add_ps(
+									carrier_phase, _mm_mul_ps(index, previous))));
+					mix_left[s] = _mm_add_ps(mix_left[s], _mm_mul_ps(out, gain_left));
+					mix_right[s] = _mm_add_ps(mix_right[s], _mm_mul_ps(out, gain_right));
+
+					modulator_phase = wrap(_mm_add_ps(modulator_phase, modulator_inc));
+					carrier_phase = wrap(_mm_add_ps(carrier_phase, carrier_inc));
+					index = _mm_add_ps(index, index_step);
+					amp = _mm_add_ps(amp, amp_step);
+				}
+
+				_mm_store_ps(modulator_phase_ + lane, modulator_phase);
+				_mm_store_ps(carrier_phase_ + lane, carrier_phase);
+				_mm_store_ps(index_ + lane, index);
+				_mm_store_ps(amp_ + lane, amp);
+				_mm_store_ps(previous_ + lane, previous);
+			}
+		}
+
+		for (std::size_t s = 0; s < n; s++) {
+			const float l = hsum(mix_left[s]) * output_gain;
+			const float r = hsum(mix_right[s]) * output_gain;
+			if (right) {
+				left[s] += l;
+				right[s] += r;
+			} else {
+				left[s] += 0.5f * (l + r);
+			}
+		}
+#else
+		float mix_left[control_block] = {};
+		float mix_right[control_block] = {};
+
+		for (std::size_t e = 0; e < elements; e++) {
+			if (!patch_[e].enabled) {
+				continue;
+			}
+			for (std::size_t lane = e * max_notes; lane < e * max_notes + groups * 4; lane++) {
+				for (std::size_t s = 0; s < n; s++) {
+					previous_[lane] = sin_cycles(modulator_phase_[lane] +
+							feedback_[lane] * previous_[lane]);
+					const float out = amp_[lane] * sin_cycles(carrier_phase_[lane] +
+							index_[lane] * previous_[lane]);
+					mix_left[s] += out * gain_left_[lane];
+					mix_right[s] += out * gain_right_[lane];
+
+					modulator_phase_[lane] = wrap(modulator_phase_[lane] + modulator_inc_[lane]);
+					carrier_phase_[lane] = wrap(carrier_phase_[lane] + carrier_inc_[lane]);
+					index_[lane] += index_step_[lane];
+					amp_[lane] += amp_step_[lane];
+				}
+			}
+		}
+
+		for (std::size_t s = 0; s < n; s++) {
+			const float l = mix_left[s] * output_gain;
+			const float r = mix_right[s] * output_gain;
+			if (right) {
+				left[s] += l;
+				right[s] += r;
+			} else {
+				left[s] += 0.5f * (l + r);
+			}
+		}
+#endif
+	}
+
+	void PreviewSynth::render(float* left, float* right, std::size_t samples) {
+		while (samples > 0) {
+			const std::size_t n = std::min(samples, control_block);
+			update(n);
+			synthesize(left, right, n);
+			left += n;
+			if (right) {
+				right += n;
+			}
+			samples -= n;
+		}
+	}
+
+};
@@ -0,0 +1,173 @@
+#ifndef _PREVIEW_SYNTH_H_
+#define _PREVIEW_SYNTH_H_ 1
+
+#include <cstddef>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Rough software rendition of a Voice, to audition edits without
+	 * the keyboard. Every element is a phase modulation pair: FM
+	 * elements use their modulator, carrier and feedback, AWM waves,
+	 * whose samples we don't have, get a brightness and ratio picked by
+	 * wave number. Envelopes, LFOs and the level vector are followed at
+	 * control rate, oscillators run per sample.
+	 *
+	 * Oscillator state is laid out as element * max_notes + note, so one
+	 * SIMD register holds the same element of consecutive notes. Playing
+	 * notes are kept packed at the front. Fixed storage only, so it may
+	 * run on the audio thread.
+	 */
+	class PreviewSynth {
+		public:
+		static const std::size_t max_notes = 16;
+		// Samples between envelope, LFO and vector updates
+		static const std::size_t control_block = 32;
+
+		PreviewSynth();
+
+		void set_sample_rate(double sample_rate);
+
+		/**
+		 * Voice for the notes to come, and the ones playing.
+		 */
+		void set_voice(const Voice& v);
+
+		/**
+		 * Start a note, taking over the oldest one if all are in use.
+		 */
+		void note_on(int key, int velocity);
+		void note_off(int key);
+		void all_notes_off();
+
+		/**
+		 * Add samples of output to left and right. With right a nullptr
+		 * both channels are added to left.
+		 */
+		void render(float* left, float* right, std::size_t samples);
+
+		std::size_t active_notes() const {
+			return count_;
+		}
+
+		private:
+		static const std::size_t elements = 4;
+		static const std::size_t lanes = elements * max_notes;
+
+		// Voice decoded into what the oscillators need
+		struct EnvelopePatch {
+			// Initial, attack, decay 1 and decay 2 level in dB
+			float level[4];
+			// Attack, decay 1, decay 2 and release in dB per second
+			float speed[4];
+			float delay;
+			float rate_scaling;
+		};
+
+		struct ElementPatch {
+			bool enabled;
+			float volume;
+			float gain_left;
+			float gain_right;
+			float pitch;
+			float detune;
+			// Modulator frequency relative to the carrier
+			float ratio;
+			// Carrier frequency in Hz regardless of key, if positive
+			float fixed;
+			// Peak modulation index and feedback, in cycles
+			float index;
+			float feedback;
+			float velocity;
+			EnvelopePatch amp;
+			EnvelopePatch mod;
+			bool mod_envelope;
+			int lfo_wave;
+			float lfo_frequency;
+			float lfo_delay;
+			float lfo_fade;
+			float am_depth;
+			float pm_depth;
+		};
+
+		// Voice wide settings the elements depend on
+		struct Common {
+			int attack;
+			int release;
+			float delay;
+		};
+
+		struct EnvelopeState {
+			int stage;
+			float db;
+			float time;
+		};
+
+		struct Note {
+			int key;
+			float velocity;
+			bool released;
+			float time;
+			unsigned long age;
+			unsigned random;
+			EnvelopeState amp[elements];
+			EnvelopeState mod[elements];
+			float lfo_phase[elements];
+			float lfo_hold[elements];
+			float rate_scale[elements];
+			float carrier_inc[elements];
+			float modulator_inc[elements];
+			std::size_t vector_step;
+			float vector_time;
+		};
+
+		// Control rate update for the next n samples
+		void update(std::size_t n);
+		void synthesize(float* left, float* right, std::size_t n);
+		void start(std::size_t slot, int key, int velocity);
+		// Oscillator increments of a note for the current voice
+		void tune(Note& note);
+		// LFO of element e, -1 to 1 after delay and fade in
+		float lfo(Note& note, std::size_t e, float dt);
+		// Move the last playing note into slot
+		void remove(std::size_t slot);
+		void vector_weights(Note& note, float dt, float* weights) const;
+
+		static void decode_envelope(const Envelope& env, int env_type,
+				const Common& common, EnvelopePatch& out);
+		static void decode_lfo(const LFO& lfo, ElementPatch& out);
+		static void decode_element(const Wave& wave, const Common& common,
+				ElementPatch& out);
+		static void decode_element(const FM& fm, const Common& common,
+				ElementPatch& out);
+		static void advance(EnvelopeState& state, const EnvelopePatch& patch,
+				float rate_scale, bool released, float dt);
+
+		double sample_rate_;
+		ElementPatch patch_[elements];
+		bool four_elements_;
+		VectorInfo vector_;
+
+		Note notes_[max_notes];
+		std::size_t count_;
+		unsigned long age_;
+
+		alignas(16) float modulator_phase_[lanes];
+		alignas(16) float carrier_phase_[lanes];
+		alignas(16) float modulator_inc_[lanes];
+		alignas(16) float carrier_inc_[lanes];
+		alignas(16) float index_[lanes];
+		alignas(16) float index_step_[lanes];
+		alignas(16) float amp_[lanes];
+		alignas(16) float amp_step_[lanes];
+		alignas(16) float feedback_[lanes];
+		alignas(16) float previous_[lanes];
+		alignas(16) float gain_left_[lanes];
+		alignas(16) float gain_right_[lanes];
+	};
+
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include <cassert>
+#include <cstring>
+
+#include "ProgramBank.h"
+
+namespace sy22 {
+
+	ProgramBank::ProgramBank() {
+		const Voice init = make_voice();
+		for (std::size_t i = 0; i < bank_voices; i++) {
+			encode_svd(init, bank_.voices[i]);
+		}
+	}
+
+	void ProgramBank::set_dumps(const unsigned char* data) {
+		std::memcpy(&bank_, data, sizeof(bank_));
+	}
+
+	void ProgramBank::set_voice(std::size_t i, const Voice& v) {
+		encode_svd(v, bank_.voices[i]);
+	}
+
+	void ProgramBank::set_bank(const Voice* voices) {
+		encode_bank(voices, bank_);
+	}
+
+	void ProgramBank::set_byte(std::size_t i, std::size_t offset,
+			unsigned char value) {
+		assert(offset < offsetof(Voice, checksum));
+		SingleVoiceDump& svd = bank_.voices[i];
+		svd.set(reinterpret_cast<unsigned char*>(&svd.voice_data)[offset], value);
+	}
+
+	void ProgramBank::set_name(std::size_t i, const char* name,
+			std::size_t length) {
+		SingleVoiceDump& svd = bank_.voices[i];
+		std::size_t n = 0;
+		for (std::size_t c = 0; c < sizeof(svd.voice_data.name); c++) {
+			unsigned char ch = ' ';
+			if (n < length) {
+				ch = static_cast<unsigned char>(name[n++]);
+				if (ch >= 0x80) {
+					// One '?' for the whole multibyte sequence
+					while (n < length && (name[n] & 0xC0) == 0x80) {
+						n++;
+					}
+					ch = '?';
+				} else if (ch < 0x20 || ch == 0x7F) {
+					ch = '?';
+				}
+			}
+			svd.set(svd.voice_data.name[c], static_cast<char>(ch));
+		}
+	}
+
+};
@@ -0,0 +1,69 @@
+#ifndef _PROGRAM_BANK_H_
+#define _PROGRAM_BANK_H_ 1
+
+#include <cstddef>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Bank of voices kept as ready to send Single Voice Dumps. A voice
+	 * is encoded when it is stored, and field edits patch the dump and
+	 * both its checksums in place, so a dump is never re-encoded just
+	 * to be sent.
+	 */
+	class ProgramBank {
+		public:
+		ProgramBank();
+
+		std::size_t size() const {
+			return bank_voices;
+		}
+
+		const Voice& voice(std::size_t i) const {
+			return bank_.voices[i].voice_data;
+		}
+
+		const SingleVoiceDump& dump(std::size_t i) const {
+			return bank_.voices[i];
+		}
+
+		/**
+		 * All dumps, as one contiguous block.
+		 */
+		const BankDump& dumps() const {
+			return bank_;
+		}
+
+		/**
+		 * Replace all dumps with a raw BankDump, which must be valid.
+		 */
+		void set_dumps(const unsigned char* data);
+
+		void set_voice(std::size_t i, const Voice& v);
+
+		/**
+		 * Replace all bank_voices voices.
+		 */
+		void set_bank(const Voice* voices);
+
+		/**
+		 * Change a single byte at given offset in Voice data of voice i.
+		 */
+		void set_byte(std::size_t i, std::size_t offset, unsigned char value);
+
+		/**
+		 * Set name of voice i from UTF-8, padded with spaces to 8
+		 * characters. Anything but printable ASCII becomes '?', so the
+		 * dump stays 7-bit.
+		 */
+		void set_name(std::size_t i, const char* name, std::size_t length);
+
+		private:
+		BankDump bank_;
+	};
+
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include <cstring>
+
+#include "SavedState.h"
+
+namespace sy22 {
+
+	namespace {
+
+		const char state_magic[4] = {'S', 'Y', '2', 'S'};
+
+		void put16(unsigned char* p, std::uint16_t v) {
+			p[0] = v & 0xFF;
+			p[1] = v >> 8;
+		}
+
+		void put32(unsigned char* p, std::uint32_t v) {
+			put16(p, v & 0xFFFF);
+			put16(p + 2, v >> 16);
+		}
+
+		std::uint16_t get16(const unsigned char* p) {
+			return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+		}
+
+		std::uint32_t get32(const unsigned char* p) {
+			return get16(p) | (static_cast<std::uint32_t>(get16(p + 2)) << 16);
+		}
+
+	};
+
+	std::size_t state_size(std::size_t banks) {
+		return state_header_size + banks * sizeof(BankDump);
+	}
+
+	void write_state_header(unsigned char* out, std::uint32_t banks,
+			std::uint32_t current_program, Model model) {
+		std::memcpy(out, state_magic, sizeof(state_magic));
+		put16(out + 4, state_version);
+		put16(out + 6, state_header_size);
+		put32(out + 8, banks);
+		put32(out + 12, current_program);
+		put32(out + 16, model);
+	}
+
+	bool read_state(const unsigned char* data, std::size_t size,
+			StateInfo& info) {
+		if (size < state_header_size ||
+				std::memcmp(data, state_magic, sizeof(state_magic)) != 0 ||
+				get16(data + 4) != state_version) {
+			return false;
+		}
+
+		// Additions within a version only grow the header
+		const std::size_t header_size = get16(data + 6);
+		const std::uint32_t banks = get32(data + 8);
+		// Divide rather than multiply, banks may be anything
+		if (header_size < state_header_size || header_size > size ||
+				(size - header_size) % sizeof(BankDump) != 0 ||
+				(size - header_size) / sizeof(BankDump) != banks) {
+			return false;
+		}
+
+		info.banks = banks;
+		info.current_program = get32(data + 12);
+		info.model = get32(data + 16) == model_sy35 ? model_sy35 : model_sy22;
+		info.bank_data = data + header_size;
+
+		const std::size_t dumps = banks * bank_voices;
+		for (std::size_t i = 0; i < dumps; i++) {
+			if (!is_valid(*reinterpret_cast<const SingleVoiceDump*>(
+							info.bank_data + i * sizeof(SingleVoiceDump)))) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+};
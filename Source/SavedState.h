@@ -0,0 +1,56 @@
+#ifndef _SAVED_STATE_H_
+#define _SAVED_STATE_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Binary plugin state:
+	 *
+	 *   magic[4] = "SY2S"
+	 *   version:u16 header_size:u16 banks:u32 current_program:u32
+	 *   model:u32
+	 *   banks * BankDump
+	 *
+	 * Integers are little endian. Banks are stored as the dumps the
+	 * programs keep anyway, so saving and loading are plain copies and
+	 * the dump checksums double as validation.
+	 */
+	const std::uint16_t state_version = 1;
+	const std::size_t state_header_size = 20;
+
+	struct StateInfo {
+		std::uint32_t banks;
+		std::uint32_t current_program;
+		Model model;
+		// First BankDump, possibly unaligned
+		const unsigned char* bank_data;
+	};
+
+	std::size_t state_size(std::size_t banks);
+
+	/**
+	 * Write the header to the start of out. The caller copies the banks
+	 * to state_bank(out, i).
+	 */
+	void write_state_header(unsigned char* out, std::uint32_t banks,
+			std::uint32_t current_program, Model model = model_sy22);
+
+	inline unsigned char* state_bank(unsigned char* state, std::size_t i) {
+		return state + state_header_size + i * sizeof(BankDump);
+	}
+
+	/**
+	 * Check header, size and every dump of a saved state. On success
+	 * info describes the banks in data.
+	 */
+	bool read_state(const unsigned char* data, std::size_t size,
+			StateInfo& info);
+
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <cstring>
+
+#include "SimulatedDevice.h"
+#include "TransmitScheduler.h"
+#include "VoiceDiff.h"
+
+namespace sy22 {
+
+	const std::size_t SimulatedDevice::max_wire_bytes;
+	const std::size_t SimulatedDevice::max_input_buffer;
+	const std::size_t SimulatedDevice::default_input_buffer;
+	const std::size_t SimulatedDevice::max_answers;
+
+	SimulatedDevice::SimulatedDevice(unsigned char device) :
+		device_(device & 0x0F),
+		sample_rate_(44100.0),
+		samples_per_byte_(44100.0 / TransmitScheduler::bytes_per_second),
+		processing_(default_processing_ms / 1000.0 * 44100.0),
+		input_size_(default_input_buffer),
+		edit_(make_voice()),
+		selected_(0),
+		store_pending_(false) {
+		std::fill(memory_, memory_ + bank_voices, edit_);
+		reset();
+		reset_stats();
+	}
+
+	void SimulatedDevice::set_sample_rate(double sample_rate) {
+		if (sample_rate > 0.0) {
+			processing_ *= sample_rate / sample_rate_;
+			sample_rate_ = sample_rate;
+			samples_per_byte_ = sample_rate / TransmitScheduler::bytes_per_second;
+		}
+	}
+
+	void SimulatedDevice::set_input_buffer(std::size_t size) {
+		input_size_ = std::max<std::size_t>(1, std::min(size, max_input_buffer));
+	}
+
+	void SimulatedDevice::set_processing_time(double seconds) {
+		processing_ = (seconds > 0.0 ? seconds : 0.0) * sample_rate_;
+	}
+
+	void SimulatedDevice::set_memory(std::size_t i, const Voice& v) {
+		memory_[i] = v;
+	}
+
+	void SimulatedDevice::reset_stats() {
+		std::memset(&stats_, 0, sizeof(stats_));
+	}
+
+	void SimulatedDevice::reset() {
+		wire_head_ = 0;
+		wire_count_ = 0;
+		wire_free_ = 0.0;
+		input_head_ = 0;
+		input_count_ = 0;
+		busy_until_ = 0.0;
+		message_size_ = 0;
+		in_sysex_ = false;
+		message_start_ = 0.0;
+		running_status_ = 0;
+		store_pending_ = false;
+		answer_head_ = 0;
+		answer_count_ = 0;
+		answers_ready_ = 0;
+		output_free_ = 0.0;
+	}
+
+	bool SimulatedDevice::receive(const unsigned char* data, std::size_t size,
+			long offset) {
+		if (wire_count_ + size > max_wire_bytes) {
+			return false;
+		}
+
+		double t = std::max(wire_free_, static_cast<double>(offset));
+		for (std::size_t i = 0; i < size; i++) {
+			// A byte is there once its last bit is
+			t += samples_per_byte_;
+			std::size_t at = (wire_head_ + wire_count_++) % max_wire_bytes;
+			wire_[at] = data[i];
+			arrival_[at] = t;
+		}
+		wire_free_ = t;
+		return true;
+	}
+
+	void SimulatedDevice::advance(long block_size) {
+		const double end = static_cast<double>(block_size);
+
+		while (wire_count_ > 0 && arrival_[wire_head_] <= end) {
+			const unsigned char byte = wire_[wire_head_];
+			const double t = arrival_[wire_head_];
+			wire_head_ = (wire_head_ + 1) % max_wire_bytes;
+			wire_count_--;
+			stats_.bytes_received++;
+
+			drain(t);
+
+			if (busy_until_ > t || input_count_ > 0) {
+				// Busy storing, the byte waits in the input buffer
+				if (input_count_ == input_size_) {
+					stats_.bytes_dropped++;
+					continue;
+				}
+				input_[(input_head_ + input_count_++) % max_input_buffer] = byte;
+				stats_.max_buffer_fill =
+					std::max(stats_.max_buffer_fill, input_count_);
+			} else {
+				consume(byte, t);
+			}
+		}
+		drain(end);
+
+		// Answers that have fully arrived at the other end
+		answers_ready_ = 0;
+		while (answers_ready_ < answer_count_ &&
+				answer_done_[(answer_head_ + answers_ready_) % max_answers] <= end) {
+			answers_ready_++;
+		}
+
+		// Move on to the next block
+		for (std::size_t i = 0; i < wire_count_; i++) {
+			arrival_[(wire_head_ + i) % max_wire_bytes] -= end;
+		}
+		for (std::size_t i = 0; i < answer_count_; i++) {
+			std::size_t at = (answer_head_ + i) % max_answers;
+			answer_done_[at] -= end;
+			answer_requested_[at] -= end;
+		}
+		wire_free_ = std::max(0.0, wire_free_ - end);
+		busy_until_ = std::max(0.0, busy_until_ - end);
+		output_free_ = std::max(0.0, output_free_ - end);
+		message_start_ -= end;
+		stats_.elapsed += end / sample_rate_;
+	}
+
+	bool SimulatedDevice::answer(SingleVoiceDump& out) {
+		if (answers_ready_ == 0) {
+			return false;
+		}
+
+		const double latency = (answer_done_[answer_head_] -
+				answer_requested_[answer_head_]) / sample_rate_;
+		stats_.max_answer_latency = std::max(stats_.max_answer_latency, latency);
+		stats_.requests_answered++;
+
+		out = answers_[answer_head_];
+		answer_head_ = (answer_head_ + 1) % max_answers;
+		answer_count_--;
+		answers_ready_--;
+		return true;
+	}
+
+	void SimulatedDevice::drain(double t) {
+		while (input_count_ > 0 && busy_until_ <= t) {
+			const unsigned char byte = input_[input_head_];
+			input_head_ = (input_head_ + 1) % max_input_buffer;
+			input_count_--;
+			// Buffered bytes are taken in the moment the device is free
+			consume(byte, busy_until_);
+		}
+	}
+
+	void SimulatedDevice::consume(unsigned char byte, double t) {
+		// System real time messages may appear anywhere
+		if (byte >= 0xF8) {
+			return;
+		}
+
+		if (byte == 0xF0) {
+			in_sysex_ = true;
+			message_size_ = 0;
+			// When the first byte started out on the wire
+			message_start_ = t - samples_per_byte_;
+		}
+
+		if (in_sysex_) {
+			if (message_size_ == sizeof(message_)) {
+				// Longer than anything we know, skip to the end
+				if (byte & 0x80) {
+					in_sysex_ = false;
+					running_status_ = byte < 0xF0 ? byte : 0;
+				}
+				return;
+			}
+			if (byte & 0x80 && byte != 0xF0) {
+				// End Of Exclusive, or any other status byte, ends it
+				in_sysex_ = false;
+				if (byte != 0xF7) {
+					running_status_ = byte < 0xF0 ? byte : 0;
+					return;
+				}
+			}
+			message_[message_size_++] = byte;
+			if (!in_sysex_) {
+				handle_sysex(t);
+			}
+			return;
+		}
+
+		if (byte & 0x80) {
+			running_status_ = byte < 0xF0 ? byte : 0;
+			return;
+		}
+
+		if (running_status_ == (0xC0 | device_)) {
+			handle_program_change(byte);
+		}
+	}
+
+	void SimulatedDevice::handle_program_change(unsigned char program) {
+		stats_.program_changes++;
+		if (program < bank_voices) {
+			selected_ = program;
+			edit_ = memory_[program];
+			store_pending_ = true;
+		}
+	}
+
+	void SimulatedDevice::handle_sysex(double t) {
+		if (message_size_ == sizeof(SingleVoiceDump)) {
+			const SingleVoiceDump& svd =
+				*reinterpret_cast<const SingleVoiceDump*>(message_);
+			if (!is_framed(svd)) {
+				stats_.broken_messages++;
+				return;
+			}
+
+			// Whatever the outcome, the device takes its time
+			busy_until_ = t + processing_;
+
+			Voice v;
+			if (!decode_svd(svd, v)) {
+				stats_.checksum_errors++;
+				return;
+			}
+
+			edit_ = v;
+			if (store_pending_) {
+				memory_[selected_] = v;
+				store_pending_ = false;
+			}
+			stats_.dumps_stored++;
+			stats_.max_dump_latency = std::max(stats_.max_dump_latency,
+					(busy_until_ - message_start_) / sample_rate_);
+			return;
+		}
+
+		if (message_size_ == sizeof(ParameterChange)) {
+			const ParameterChange& change =
+				*reinterpret_cast<const ParameterChange*>(message_);
+			const std::size_t offset =
+				(change.address_msb << 7) | change.address_lsb;
+			if (change.manufacturer != 0x43 ||
+					change.device != (0x10 | device_) ||
+					change.group != 0x26 || change.sub_group != 0x02 ||
+					offset >= offsetof(Voice, null)) {
+				stats_.broken_messages++;
+				return;
+			}
+
+			unsigned char* data = reinterpret_cast<unsigned char*>(&edit_);
+			if (is_overflow_byte(offset)) {
+				data[offset] = change.value_msb;
+				data[offset + 1] = change.value_lsb;
+			} else {
+				data[offset] = change.value_lsb;
+			}
+			edit_.update_checksum();
+			stats_.parameter_changes++;
+			return;
+		}
+
+		const DumpRequest request = make_dump_request(device_);
+		if (message_size_ != sizeof(request) ||
+				std::memcmp(message_, &request, sizeof(request)) != 0) {
+			stats_.broken_messages++;
+			return;
+		}
+
+		if (answer_count_ == max_answers) {
+			stats_.requests_dropped++;
+			return;
+		}
+
+		const std::size_t at = (answer_head_ + answer_count_++) % max_answers;
+		encode_svd(edit_, answers_[at], device_);
+		output_free_ = std::max(output_free_, t) +
+			sizeof(SingleVoiceDump) * samples_per_byte_;
+		answer_done_[at] = output_free_;
+		answer_requested_[at] = message_start_;
+	}
+
+};
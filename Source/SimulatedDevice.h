@@ -0,0 +1,161 @@
+#ifndef _SIMULATED_DEVICE_H_
+#define _SIMULATED_DEVICE_H_ 1
+
+#include <cstddef>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Software stand-in for the SY22 at the far end of a MIDI cable.
+	 * Bytes take their 31.25 kbaud wire time to arrive and land in a
+	 * finite input buffer. The device drains it except while storing a
+	 * bulk dump, so data sent without a gap overflows it and is lost.
+	 * Dumps are checked with decode_svd and loaded into the edit buffer,
+	 * parameter changes are applied to it, and dump requests are
+	 * answered with it over a wire of its own.
+	 *
+	 * A Program Change loads its voice memory into the edit buffer, and
+	 * the first dump after it is also stored into that memory. This is
+	 * an assumption of the model, not documented SY22 behaviour, and
+	 * BankUpload's read-back relies on it.
+	 *
+	 * Time is counted in samples of blocks, like TransmitScheduler.
+	 * Fixed storage only, so it may run on the audio thread.
+	 */
+	class SimulatedDevice {
+		public:
+		// Bytes on the way that haven't reached the input buffer yet
+		static const std::size_t max_wire_bytes = 8192;
+		static const std::size_t max_input_buffer = 4096;
+		static const std::size_t default_input_buffer = 256;
+		// Same as the gap TransmitScheduler allows for by default
+		static const int default_processing_ms = 100;
+		// Answers waiting for the output wire
+		static const std::size_t max_answers = 4;
+
+		struct Stats {
+			std::size_t bytes_received;
+			// Arrived while the input buffer was full
+			std::size_t bytes_dropped;
+			std::size_t max_buffer_fill;
+			std::size_t dumps_stored;
+			std::size_t checksum_errors;
+			// SysEx that is none of the messages known, e.g. a dump
+			// that lost bytes
+			std::size_t broken_messages;
+			std::size_t parameter_changes;
+			std::size_t program_changes;
+			std::size_t requests_answered;
+			std::size_t requests_dropped;
+			// Seconds from the first byte of a dump going out to the
+			// device having stored it, and from a request going out to
+			// its answer having arrived
+			double max_dump_latency;
+			double max_answer_latency;
+			double elapsed;
+		};
+
+		explicit SimulatedDevice(unsigned char device = 0);
+
+		void set_sample_rate(double sample_rate);
+		void set_input_buffer(std::size_t size);
+		void set_processing_time(double seconds);
+
+		/**
+		 * A message sent to the device at offset within the current
+		 * block. Bytes queue up behind any still on the wire. Returns
+		 * false if the wire backlog is full and nothing was taken.
+		 */
+		bool receive(const unsigned char* data, std::size_t size, long offset);
+
+		/**
+		 * Run the device up to the end of the current block and move on
+		 * to the next.
+		 */
+		void advance(long block_size);
+
+		/**
+		 * Next dump the device has finished sending back, in order.
+		 */
+		bool answer(SingleVoiceDump& out);
+
+		const Voice& edit_buffer() const {
+			return edit_;
+		}
+
+		const Voice& memory(std::size_t i) const {
+			return memory_[i];
+		}
+
+		void set_memory(std::size_t i, const Voice& v);
+
+		const Stats& stats() const {
+			return stats_;
+		}
+
+		void reset_stats();
+
+		/**
+		 * Forget anything on the wires and in the input buffer.
+		 */
+		void reset();
+
+		private:
+		// Device takes in a byte that arrived at sample t
+		void consume(unsigned char byte, double t);
+		// Drain the input buffer for as long as the device is free
+		// before sample t
+		void drain(double t);
+		void handle_sysex(double t);
+		void handle_program_change(unsigned char program);
+
+		unsigned char device_;
+		double sample_rate_;
+		double samples_per_byte_;
+		double processing_;
+		std::size_t input_size_;
+
+		// Bytes on the input wire with their arrival, relative to the
+		// start of the current block
+		unsigned char wire_[max_wire_bytes];
+		double arrival_[max_wire_bytes];
+		std::size_t wire_head_;
+		std::size_t wire_count_;
+		double wire_free_;
+
+		unsigned char input_[max_input_buffer];
+		std::size_t input_head_;
+		std::size_t input_count_;
+		// Storing a dump until then
+		double busy_until_;
+
+		// Message being assembled
+		unsigned char message_[sizeof(SingleVoiceDump)];
+		std::size_t message_size_;
+		bool in_sysex_;
+		double message_start_;
+		unsigned char running_status_;
+
+		Voice edit_;
+		Voice memory_[bank_voices];
+		// Memory a Program Change selected, stored into by the next dump
+		std::size_t selected_;
+		bool store_pending_;
+
+		SingleVoiceDump answers_[max_answers];
+		double answer_done_[max_answers];
+		double answer_requested_[max_answers];
+		std::size_t answer_head_;
+		std::size_t answer_count_;
+		// Answers finished sending, ready for answer()
+		std::size_t answers_ready_;
+		double output_free_;
+
+		Stats stats_;
+	};
+
+};
+
+#endif
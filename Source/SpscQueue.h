@@ -0,0 +1,115 @@
+#ifndef _SPSC_QUEUE_H_
+#define _SPSC_QUEUE_H_ 1
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace sy22 {
+
+	/**
+	 * Bounded wait-free single producer, single consumer queue. Entries
+	 * live in a fixed array and are copied in and out, so neither side
+	 * allocates, locks or waits. Meant for handing data between the
+	 * message thread and the audio thread.
+	 */
+	template <class T, std::size_t Size>
+	class SpscQueue {
+		static_assert(Size > 0 && (Size & (Size - 1)) == 0,
+				"queue size must be a power of two");
+		static_assert(std::is_trivially_copyable<T>::value,
+				"queue entries must be plain data");
+
+		public:
+		SpscQueue() : head_(0), tail_(0) {}
+
+		/**
+		 * Producer: append a copy of item, false if the queue is full.
+		 */
+		bool push(const T& item) {
+			T* slot = prepare_push();
+			if (!slot) {
+				return false;
+			}
+			*slot = item;
+			commit_push();
+			return true;
+		}
+
+		/**
+		 * Producer: slot for the next item to be filled in place, or
+		 * nullptr if the queue is full. Item becomes visible to the
+		 * consumer on commit_push().
+		 */
+		T* prepare_push() {
+			std::size_t tail = tail_.load(std::memory_order_relaxed);
+			if (tail - head_.load(std::memory_order_acquire) == Size) {
+				return nullptr;
+			}
+			return &items_[tail & (Size - 1)];
+		}
+
+		void commit_push() {
+			tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+					std::memory_order_release);
+		}
+
+		/**
+		 * Consumer: oldest item, or nullptr if the queue is empty. Stays
+		 * valid until pop().
+		 */
+		T* front() {
+			std::size_t head = head_.load(std::memory_order_relaxed);
+			if (head == tail_.load(std::memory_order_acquire)) {
+				return nullptr;
+			}
+			return &items_[head & (Size - 1)];
+		}
+
+		void pop() {
+			head_.store(head_.load(std::memory_order_relaxed) + 1,
+					std::memory_order_release);
+		}
+
+		/**
+		 * Consumer: move the oldest item to item, false if empty.
+		 */
+		bool pop(T& item) {
+			T* slot = front();
+			if (!slot) {
+				return false;
+			}
+			item = *slot;
+			pop();
+			return true;
+		}
+
+		/**
+		 * Number of queued items. Exact for either end, approximate for
+		 * any other thread.
+		 */
+		std::size_t size() const {
+			return tail_.load(std::memory_order_acquire) -
+				head_.load(std::memory_order_acquire);
+		}
+
+		static std::size_t capacity() {
+			return Size;
+		}
+
+		private:
+		// Keep the indices on separate cache lines so that producer and
+		// consumer don't fight over them. Padding rather than alignas,
+		// operator new ignores over-alignment before C++17.
+		static const std::size_t cache_line = 64;
+
+		std::atomic<std::size_t> head_;
+		char head_pad_[cache_line - sizeof(std::atomic<std::size_t>)];
+		std::atomic<std::size_t> tail_;
+		char tail_pad_[cache_line - sizeof(std::atomic<std::size_t>)];
+		T items_[Size];
+	};
+
+};
+
+#endif
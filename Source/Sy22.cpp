@@ -1,53 +1,316 @@
-#include <set>
 #include <numeric>
 
+#include <cassert>
+#include <cstddef>
 #include <cstring>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Indices.h"
 #include "Sy22.h"
+#include "VoiceFields.h"
 
 namespace sy22 {
 
-	const std::set<int> overflow_bytes = {
-		// Common
-		0x0B, 0x0E, 0x11, 0x13,
-		// Element A
-		0x16, 0x19, 0x1B, 0x1D, 0x24, 0x26, 0x28,
-		// Element B
-		0x30, 0x32, 0x35, 0x37, 0x39, 0x3F, 0x43, 0x45, 0x47, 0x4F,
-		0x53, 0x55, 0x57,
-		// Element C
-		0x60, 0x63, 0x65, 0x67, 0x6E, 0x70, 0x72,
-		// Element D
-		0x7A, 0x7C, 0x7F, 0x81, 0x83, 0x89, 0x8D, 0x8F, 0x91, 0x99,
-		0x9D, 0x9F, 0xA1,
-		// Vector info overflow bytes
-		0xAB, 0xAF, 0xB3, 0xB7, 0xBB, 0xBF, 0xC3, 0xC7, 0xCB, 0xCF,
-		0xD3, 0xD7, 0xDB, 0xDF, 0xE3, 0xE7, 0xEB, 0xEF, 0xF3, 0xF7,
-		0xFB, 0xFF, 0x103, 0x107, 0x10B, 0x10F, 0x113, 0x117, 0x11B,
-		0x11F, 0x123, 0x127, 0x12B, 0x12F, 0x133, 0x137, 0x13B, 0x13F,
-		0x143, 0x147, 0x14B, 0x14F, 0x153, 0x157, 0x15B, 0x15F, 0x163,
-		0x167, 0x16B, 0x16F, 0x173, 0x177, 0x17B, 0x17F, 0x183, 0x187,
-		0x18B, 0x18F, 0x193, 0x197, 0x19B, 0x19F, 0x1A3, 0x1A7, 0x1AB,
-		0x1AF, 0x1B3, 0x1B7, 0x1BB, 0x1BF, 0x1C3, 0x1C7, 0x1CB, 0x1CF,
-		0x1D3, 0x1D7, 0x1DB, 0x1DF, 0x1E3, 0x1E7, 0x1EB, 0x1EF, 0x1F3,
-		0x1F7, 0x1FB, 0x1FF, 0x203, 0x207, 0x20B, 0x20F, 0x213, 0x217,
-		0x21B, 0x21F, 0x223, 0x227, 0x22B, 0x22F, 0x233, 0x237
+	constexpr Model Sy22Model::id;
+	constexpr const char* Sy22Model::name;
+	constexpr char Sy22Model::header[];
+	constexpr Model Sy35Model::id;
+	constexpr const char* Sy35Model::name;
+	constexpr char Sy35Model::header[];
+
+	const char* model_name(Model model) {
+		return model == model_sy35 ? Sy35Model::name : Sy22Model::name;
+	}
+
+	namespace {
+
+		/**
+		 * Byte masks for the checksum kernel, one entry per Voice byte.
+		 * Regular bytes are summed as is, of overflow bytes only the
+		 * lowest bit counts and it is weighted by 128; that mask is
+		 * voice_bytes::overflow of VoiceFields.h.
+		 */
+		template <class> struct weight_masks;
+
+		template <std::size_t... I>
+		struct weight_masks<indices<I...>> {
+			static constexpr unsigned char regular[sizeof...(I)] = {
+				static_cast<unsigned char>(overflow_byte(I) ? 0x00 : 0xFF)...
+			};
+		};
+
+		template <std::size_t... I>
+		constexpr unsigned char weight_masks<indices<I...>>::regular[sizeof...(I)];
+
+		// The checksum does not cover itself
+		constexpr std::size_t checksummed_bytes = offsetof(Voice, checksum);
+
+		using voice_masks = weight_masks<make_indices<checksummed_bytes>::type>;
+
+#if defined(__AVX2__)
+		inline int hsum(__m256i v) {
+			__m128i s = _mm_add_epi64(
+					_mm256_castsi256_si128(v),
+					_mm256_extracti128_si256(v, 1));
+			return _mm_cvtsi128_si32(_mm_add_epi64(s, _mm_srli_si128(s, 8)));
+		}
+#endif
+#if defined(__SSE2__)
+		inline int hsum(__m128i v) {
+			return _mm_cvtsi128_si32(_mm_add_epi64(v, _mm_srli_si128(v, 8)));
+		}
+#endif
+
+		/**
+		 * Sum of regular bytes and sum of overflow bits of Voice data,
+		 * 32 or 16 bytes at a time where SIMD is available. With Copy
+		 * the data is also stored to out and its plain byte sum, as
+		 * needed by the 7-bit SysEx checksum, added to plain, all in the
+		 * same pass.
+		 */
+		template <bool Copy>
+		int weighted_sum(const unsigned char* data, unsigned char* out,
+				int* plain) {
+			const unsigned char* regular = voice_masks::regular;
+			const unsigned char* overflow = voice_bytes::overflow;
+			std::size_t i = 0;
+			int sum = 0;
+			int overflow_sum = 0;
+			int plain_sum = 0;
+
+#if defined(__AVX2__)
+			{
+				__m256i acc = _mm256_setzero_si256();
+				__m256i acc_overflow = _mm256_setzero_si256();
+				__m256i acc_plain = _mm256_setzero_si256();
+				const __m256i zero = _mm256_setzero_si256();
+				for (; i + 32 <= checksummed_bytes; i += 32) {
+					__m256i b = _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(data + i));
+					__m256i r = _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(regular + i));
+					__m256i o = _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(overflow + i));
+					acc = _mm256_add_epi64(acc,
+							_mm256_sad_epu8(_mm256_and_si256(b, r), zero));
+					acc_overflow = _mm256_add_epi64(acc_overflow,
+							_mm256_sad_epu8(_mm256_and_si256(b, o), zero));
+					if (Copy) {
+						acc_plain = _mm256_add_epi64(acc_plain,
+								_mm256_sad_epu8(b, zero));
+						_mm256_storeu_si256(
+								reinterpret_cast<__m256i*>(out + i), b);
+					}
+				}
+				sum += hsum(acc);
+				overflow_sum += hsum(acc_overflow);
+				if (Copy) {
+					plain_sum += hsum(acc_plain);
+				}
+			}
+#endif
+#if defined(__SSE2__)
+			{
+				__m128i acc = _mm_setzero_si128();
+				__m128i acc_overflow = _mm_setzero_si128();
+				__m128i acc_plain = _mm_setzero_si128();
+				const __m128i zero = _mm_setzero_si128();
+				for (; i + 16 <= checksummed_bytes; i += 16) {
+					__m128i b = _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(data + i));
+					__m128i r = _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(regular + i));
+					__m128i o = _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(overflow + i));
+					acc = _mm_add_epi64(acc,
+							_mm_sad_epu8(_mm_and_si128(b, r), zero));
+					acc_overflow = _mm_add_epi64(acc_overflow,
+							_mm_sad_epu8(_mm_and_si128(b, o), zero));
+					if (Copy) {
+						acc_plain = _mm_add_epi64(acc_plain,
+								_mm_sad_epu8(b, zero));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), b);
+					}
+				}
+				sum += hsum(acc);
+				overflow_sum += hsum(acc_overflow);
+				if (Copy) {
+					plain_sum += hsum(acc_plain);
+				}
+			}
+#endif
+			// Scalar tail, or the whole thing without SIMD
+			for (; i < checksummed_bytes; i++) {
+				sum += data[i] & regular[i];
+				overflow_sum += data[i] & overflow[i];
+				if (Copy) {
+					plain_sum += data[i];
+					out[i] = data[i];
+				}
+			}
+
+			if (Copy) {
+				*plain += plain_sum;
+			}
+
+			// Overflow bytes are the 8th bit of a byte
+			return sum + (overflow_sum << 7);
+		}
+
+		int weighted_sum(const unsigned char* data) {
+			return weighted_sum<false>(data, nullptr, nullptr);
+		}
+
+		// Voices checksummed together by checksums()
+		const std::size_t voice_batch = 4;
+
+#if defined(__AVX2__)
+		inline void accumulate(__m256i* acc, __m256i b, __m256i r, __m256i o,
+				__m256i zero) {
+			acc[0] = _mm256_add_epi64(acc[0],
+					_mm256_sad_epu8(_mm256_and_si256(b, r), zero));
+			acc[1] = _mm256_add_epi64(acc[1],
+					_mm256_sad_epu8(_mm256_and_si256(b, o), zero));
+		}
+#endif
+#if defined(__SSE2__)
+		inline void accumulate(__m128i* acc, __m128i b, __m128i r, __m128i o,
+				__m128i zero) {
+			acc[0] = _mm_add_epi64(acc[0],
+					_mm_sad_epu8(_mm_and_si128(b, r), zero));
+			acc[1] = _mm_add_epi64(acc[1],
+					_mm_sad_epu8(_mm_and_si128(b, o), zero));
+		}
+#endif
+
+		/**
+		 * weighted_sum of voice_batch voices side by side. The masks of
+		 * each block of bytes are loaded once for the whole batch, and
+		 * the overflow sum of a voice is weighted into its regular sum
+		 * before the one horizontal add per voice. The voices are
+		 * spelled out so that their sums stay in registers.
+		 */
+		void batch_sums(const Voice* voices, int* sums) {
+			const unsigned char* regular = voice_masks::regular;
+			const unsigned char* overflow = voice_bytes::overflow;
+			const unsigned char* data0 =
+				reinterpret_cast<const unsigned char*>(&voices[0]);
+			const unsigned char* data1 =
+				reinterpret_cast<const unsigned char*>(&voices[1]);
+			const unsigned char* data2 =
+				reinterpret_cast<const unsigned char*>(&voices[2]);
+			const unsigned char* data3 =
+				reinterpret_cast<const unsigned char*>(&voices[3]);
+			std::size_t i = 0;
+			sums[0] = sums[1] = sums[2] = sums[3] = 0;
+
+#if defined(__AVX2__)
+			{
+				const __m256i zero = _mm256_setzero_si256();
+				__m256i acc[voice_batch][2] = {};
+				for (; i + 32 <= checksummed_bytes; i += 32) {
+					const __m256i r = _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(regular + i));
+					const __m256i o = _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(overflow + i));
+					accumulate(acc[0], _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(data0 + i)), r, o, zero);
+					accumulate(acc[1], _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(data1 + i)), r, o, zero);
+					accumulate(acc[2], _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(data2 + i)), r, o, zero);
+					accumulate(acc[3], _mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(data3 + i)), r, o, zero);
+				}
+				for (std::size_t v = 0; v < voice_batch; v++) {
+					sums[v] += hsum(_mm256_add_epi64(acc[v][0],
+								_mm256_slli_epi64(acc[v][1], 7)));
+				}
+			}
+#endif
+#if defined(__SSE2__)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				__m128i acc[voice_batch][2] = {};
+				for (; i + 16 <= checksummed_bytes; i += 16) {
+					const __m128i r = _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(regular + i));
+					const __m128i o = _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(overflow + i));
+					accumulate(acc[0], _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(data0 + i)), r, o, zero);
+					accumulate(acc[1], _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(data1 + i)), r, o, zero);
+					accumulate(acc[2], _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(data2 + i)), r, o, zero);
+					accumulate(acc[3], _mm_loadu_si128(
+							reinterpret_cast<const __m128i*>(data3 + i)), r, o, zero);
+				}
+				for (std::size_t v = 0; v < voice_batch; v++) {
+					sums[v] += hsum(_mm_add_epi64(acc[v][0],
+								_mm_slli_epi64(acc[v][1], 7)));
+				}
+			}
+#endif
+			// Scalar tail, or the whole thing without SIMD
+			for (; i < checksummed_bytes; i++) {
+				const int r = regular[i];
+				const int o = overflow[i];
+				sums[0] += (data0[i] & r) + ((data0[i] & o) << 7);
+				sums[1] += (data1[i] & r) + ((data1[i] & o) << 7);
+				sums[2] += (data2[i] & r) + ((data2[i] & o) << 7);
+				sums[3] += (data3[i] & r) + ((data3[i] & o) << 7);
+			}
+		}
+
+		constexpr int header_sum(const char* header, std::size_t n) {
+			return n ? header[0] + header_sum(header + 1, n - 1) : 0;
+		}
+
+		// Sum of the model's header, the constant part of the SysEx
+		// checksum
+		template <class Model>
+		struct svd_header {
+			static constexpr int sum =
+				header_sum(Model::header, sizeof(Model::header) - 1);
+		};
+
 	};
 
 	int byte_sum(const Voice& v) {
-		int sum = 0;
-		const unsigned char* voice_data_ptr =
-			reinterpret_cast<const unsigned char*>(&v);
-		for (int i = 0; i < sizeof(Voice); i++) {
-			unsigned char b = voice_data_ptr[i];
-			// Check if given byte is an overflow byte
-			if (overflow_bytes.count(i)) {
-				// Overflow bytes are the 8th bit of a byte
-				b <<= 7;
+		return weighted_sum(reinterpret_cast<const unsigned char*>(&v));
+	}
+
+	int byte_sum(const unsigned char* voice_data) {
+		return weighted_sum(voice_data);
+	}
+
+	void checksums(const Voice* voices, std::size_t count, midi::byte_t* out) {
+		std::size_t i = 0;
+		for (; i + voice_batch <= count; i += voice_batch) {
+			int sums[voice_batch];
+			batch_sums(voices + i, sums);
+			for (std::size_t v = 0; v < voice_batch; v++) {
+				out[i + v] = midi::UChar(-sums[v]);
 			}
-			sum += b;
 		}
-		return sum;
+		for (; i < count; i++) {
+			out[i] = midi::UChar(-byte_sum(voices[i]));
+		}
+	}
+
+	std::uint64_t content_hash(const Voice& v) {
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(&v);
+		std::uint64_t hash = 14695981039346656037ULL;
+		for (std::size_t i = 0; i < checksummed_bytes; i++) {
+			hash = (hash ^ data[i]) * 1099511628211ULL;
+		}
+		return hash;
 	}
 
 	Voice make_voice() {
@@ -69,37 +332,239 @@ namespace sy22 {
 		checksum = midi::UChar(-byte_sum(*this));
 	}
 
-#define SY22_SVD_HEADER "PK  2203AE"
+	bool is_overflow_byte(std::size_t offset) {
+		return offset < checksummed_bytes && voice_bytes::overflow[offset];
+	}
+
+	int weighted_byte(std::size_t offset, unsigned char value) {
+		assert(offset < checksummed_bytes);
+		return (value & voice_masks::regular[offset]) +
+			((value & voice_bytes::overflow[offset]) << 7);
+	}
+
+	namespace {
+
+		/**
+		 * Replace a single byte of Voice data and subtract its weighted
+		 * change from the checksum.
+		 */
+		void set_byte(Voice& v, const void* field, unsigned char value) {
+			unsigned char* data = reinterpret_cast<unsigned char*>(&v);
+			std::size_t offset = static_cast<const unsigned char*>(field) - data;
+
+			int delta = weighted_byte(offset, value) -
+				weighted_byte(offset, data[offset]);
+
+			data[offset] = value;
+			v.checksum = midi::UChar(midi::UChar(v.checksum) - delta);
+		}
+
+		int plain_sum(const unsigned char& field, const midi::byte_t& checksum) {
+			return field + checksum.msb + checksum.lsb;
+		}
+
+	};
+
+	void Voice::set(unsigned char& field, unsigned char value) {
+		set_byte(*this, &field, value);
+	}
+
+	void Voice::set(char& field, char value) {
+		set_byte(*this, &field, static_cast<unsigned char>(value));
+	}
+
+	void Voice::set(midi::byte_t& field, midi::byte_t value) {
+		set(field.msb, value.msb);
+		set(field.lsb, value.lsb);
+	}
+
+	void SingleVoiceDump::update_checksum() {
+		voice_data.update_checksum();
+
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(header);
+		int sum = std::accumulate(data, data + sizeof(header) + sizeof(Voice), 0);
+		checksum = -sum & 0x7F;
+	}
+
+	void SingleVoiceDump::set(unsigned char& field, unsigned char value) {
+		// The 7-bit checksum is a plain sum, so only the changed byte and
+		// the Voice checksum bytes matter.
+		int before = plain_sum(field, voice_data.checksum);
+		voice_data.set(field, value);
+		int after = plain_sum(field, voice_data.checksum);
+		checksum = (checksum - (after - before)) & 0x7F;
+	}
+
+	void SingleVoiceDump::set(char& field, char value) {
+		set(reinterpret_cast<unsigned char&>(field),
+				static_cast<unsigned char>(value));
+	}
+
+	void SingleVoiceDump::set(midi::byte_t& field, midi::byte_t value) {
+		set(field.msb, value.msb);
+		set(field.lsb, value.lsb);
+	}
 
 	/**
 	 * Create a new Single Voice Dump message and populate with given
 	 * Voice data.
 	 */
-	SingleVoiceDump make_svd(Voice &v) {
+	template <class Model>
+	SingleVoiceDump make_svd(const Voice &v) {
 		const unsigned char* voice_data_ptr =
-			reinterpret_cast<const unsigned char*>(&voice);
+			reinterpret_cast<const unsigned char*>(&v);
 
-		int sum = std::accumulate(
-				SY22_SVD_HEADER,
-				SY22_SVD_HEADER + sizeof(SY22_SVD_HEADER) - 1,
-				0);
+		int sum = svd_header<Model>::sum;
 		sum += std::accumulate(
 				voice_data_ptr,
 				voice_data_ptr + sizeof(Voice),
 				0);
 
-		return {
+		SingleVoiceDump svd = {
 			0xF0,
 			0x43,
 			0,
 			0x7E,
 			0x04,
 			0x48,
-			{'P', 'K', ' ', ' ', '2', '2', '0', '3', 'A', 'E'},
+			{},
 			{v},
 			static_cast<unsigned char>(-sum & 0x7F),
 			0xF7,
 		};
+		std::memcpy(svd.header, Model::header, sizeof(svd.header));
+		return svd;
+	}
+
+	template <class Model>
+	DumpRequest make_dump_request(unsigned char device) {
+		DumpRequest request = {
+			0xF0,
+			0x43,
+			static_cast<unsigned char>(0x20 | (device & 0x0F)),
+			0x7E,
+			{},
+			0xF7,
+		};
+		std::memcpy(request.header, Model::header, sizeof(request.header));
+		return request;
+	}
+
+	template <class Model>
+	bool is_framed(const SingleVoiceDump& svd) {
+		return svd.start_of_sysex == 0xF0 && svd.reserved_0 == 0x43 &&
+			(svd.channel & 0xF0) == 0 && svd.reserved_1 == 0x7E &&
+			svd.count_msb == 0x04 && svd.count_lsb == 0x48 &&
+			svd.eox == 0xF7 &&
+			std::memcmp(svd.header, Model::header, sizeof(svd.header)) == 0;
 	}
 
+	bool checksum_ok(const Voice& v) {
+		return midi::UChar(v.checksum) ==
+			static_cast<unsigned char>(-byte_sum(v));
+	}
+
+	bool sysex_checksum_ok(const SingleVoiceDump& svd) {
+		const unsigned char* data =
+			reinterpret_cast<const unsigned char*>(&svd.header);
+		int sum = std::accumulate(
+				data,
+				data + sizeof(svd.header) + sizeof(Voice) + 1,
+				0);
+		return (sum & 0x7F) == 0;
+	}
+
+	bool sysex_data_ok(const SingleVoiceDump& svd) {
+		const unsigned char* data =
+			reinterpret_cast<const unsigned char*>(&svd) + 1;
+		unsigned char bits = 0;
+		for (std::size_t i = 0; i < sizeof(svd) - 2; i++) {
+			bits |= data[i];
+		}
+		return (bits & 0x80) == 0;
+	}
+
+	template <class Model>
+	void encode_svd(const Voice& v, SingleVoiceDump& out, unsigned char device) {
+		out.start_of_sysex = 0xF0;
+		out.reserved_0 = 0x43;
+		out.channel = device & 0x0F;
+		out.reserved_1 = 0x7E;
+		out.count_msb = 0x04;
+		out.count_lsb = 0x48;
+		std::memcpy(out.header, Model::header, sizeof(out.header));
+
+		int sum = svd_header<Model>::sum;
+		Voice& voice = out.voice_data;
+		midi::byte_t checksum = midi::UChar(-weighted_sum<true>(
+					reinterpret_cast<const unsigned char*>(&v),
+					reinterpret_cast<unsigned char*>(&voice),
+					&sum));
+		voice.checksum = checksum;
+
+		out.checksum = -(sum + checksum.msb + checksum.lsb) & 0x7F;
+		out.eox = 0xF7;
+	}
+
+	template <class Model>
+	bool decode_svd(const SingleVoiceDump& svd, Voice& out) {
+		if (!is_framed<Model>(svd)) {
+			return false;
+		}
+
+		int sum = svd_header<Model>::sum;
+		int checksum = midi::UChar(-weighted_sum<true>(
+					reinterpret_cast<const unsigned char*>(&svd.voice_data),
+					reinterpret_cast<unsigned char*>(&out),
+					&sum)) & 0xFF;
+		out.checksum = svd.voice_data.checksum;
+
+		sum += out.checksum.msb + out.checksum.lsb + svd.checksum;
+		return (sum & 0x7F) == 0 && midi::UChar(out.checksum) == checksum;
+	}
+
+	template <class Model>
+	void encode_bank(const Voice* voices, BankDump& out, unsigned char device) {
+		for (std::size_t i = 0; i < bank_voices; i++) {
+			encode_svd<Model>(voices[i], out.voices[i], device);
+		}
+	}
+
+	template <class Model>
+	std::size_t decode_bank(const unsigned char* data, std::size_t size,
+			Voice* voices) {
+		std::size_t count = 0;
+		while (count < bank_voices && size >= sizeof(SingleVoiceDump) &&
+				decode_svd<Model>(*reinterpret_cast<const SingleVoiceDump*>(data),
+					voices[count])) {
+			data += sizeof(SingleVoiceDump);
+			size -= sizeof(SingleVoiceDump);
+			count++;
+		}
+		return count;
+	}
+
+	template <class Model>
+	bool is_valid(const SingleVoiceDump& svd) {
+		return is_framed<Model>(svd) && sysex_data_ok(svd) &&
+			sysex_checksum_ok(svd) && checksum_ok(svd.voice_data);
+	}
+
+#define SY22_MODEL_CODECS(Model) \
+	template SingleVoiceDump make_svd<Model>(const Voice&); \
+	template DumpRequest make_dump_request<Model>(unsigned char); \
+	template bool is_framed<Model>(const SingleVoiceDump&); \
+	template void encode_svd<Model>(const Voice&, SingleVoiceDump&, \
+			unsigned char); \
+	template bool decode_svd<Model>(const SingleVoiceDump&, Voice&); \
+	template void encode_bank<Model>(const Voice*, BankDump&, unsigned char); \
+	template std::size_t decode_bank<Model>(const unsigned char*, \
+			std::size_t, Voice*); \
+	template bool is_valid<Model>(const SingleVoiceDump&);
+
+	SY22_MODEL_CODECS(Sy22Model)
+	SY22_MODEL_CODECS(Sy35Model)
+
+#undef SY22_MODEL_CODECS
+
 };
@@ -1,8 +1,16 @@
 #ifndef _SY22_H_
 #define _SY22_H_ 1
 
+#include <cstddef>
+#include <cstdint>
+
 #include "MidiData.h"
 
+#define SY22_SVD_HEADER "PK  2203AE"
+// The form document is the SY35's, and its header is the one the SY22
+// answers to as well
+#define SY35_SVD_HEADER SY22_SVD_HEADER
+
 /**
  * http://worsa.republika.pl/yamaha-sy35/sy35form.txt
  */
@@ -378,8 +386,21 @@ namespace sy22 {
 		midi::byte_t checksum;
 
 		void update_checksum();
+
+		/**
+		 * Set a field of this Voice and adjust checksum by the change
+		 * instead of rescanning the whole Voice. Field must be a member
+		 * of this Voice.
+		 */
+		void set(unsigned char& field, unsigned char value);
+		void set(char& field, char value);
+		void set(midi::byte_t& field, midi::byte_t value);
 	};
 
+	// 23E bytes as in the form document, no padding anywhere
+	static_assert(sizeof(Voice) == 574, "Voice layout");
+	static_assert(offsetof(Voice, checksum) == 0x23C, "Voice layout");
+
 	struct SingleVoiceDump {
 		unsigned char start_of_sysex;
 		unsigned char reserved_0;
@@ -393,8 +414,183 @@ namespace sy22 {
 		unsigned char eox;
 
 		//SingleVoiceDump(Voice&);
+
+		/**
+		 * Recalculate both the Voice checksum and the 7-bit SysEx
+		 * checksum.
+		 */
+		void update_checksum();
+
+		/**
+		 * Set a field of voice_data, keeping both the Voice checksum
+		 * and the 7-bit SysEx checksum in sync.
+		 */
+		void set(unsigned char& field, unsigned char value);
+		void set(char& field, char value);
+		void set(midi::byte_t& field, midi::byte_t value);
+	};
+
+	static_assert(sizeof(SingleVoiceDump) == 592, "SingleVoiceDump layout");
+
+	// Models by number, for choosing one at run time
+	enum Model {
+		model_sy22,
+		model_sy35
+	};
+
+	/**
+	 * Model traits. Both models share the Voice layout of the form
+	 * document; what tells their dumps apart is kept here. The dump
+	 * codecs below are templates on these, so each model compiles into
+	 * its own codec with the header and its checksum as constants.
+	 * Sy22.cpp instantiates them for both; without a model they are
+	 * the SY22's.
+	 */
+	struct Sy22Model {
+		static constexpr Model id = model_sy22;
+		static constexpr const char* name = "SY22";
+		static constexpr char header[] = SY22_SVD_HEADER;
+	};
+
+	struct Sy35Model {
+		static constexpr Model id = model_sy35;
+		static constexpr const char* name = "SY35";
+		static constexpr char header[] = SY35_SVD_HEADER;
+	};
+
+	static_assert(sizeof(Sy22Model::header) - 1 == sizeof(SingleVoiceDump::header),
+			"SY22 header fits a dump");
+	static_assert(sizeof(Sy35Model::header) - 1 == sizeof(SingleVoiceDump::header),
+			"SY35 header fits a dump");
+
+	const char* model_name(Model);
+
+	/**
+	 * Request for the voice in the edit buffer. The SY22 answers with a
+	 * Single Voice Dump. Voice memory is selected beforehand with a
+	 * Program Change, the way the front panel does it.
+	 */
+	struct DumpRequest {
+		unsigned char start_of_sysex;
+		unsigned char reserved_0;
+		unsigned char channel;
+		unsigned char reserved_1;
+		char header[10];
+		unsigned char eox;
+	};
+
+	template <class Model = Sy22Model>
+	DumpRequest make_dump_request(unsigned char device = 0);
+
+	/**
+	 * Sum of Voice data bytes preceding the checksum, overflow bytes
+	 * weighted by 128.
+	 */
+	int byte_sum(const Voice&);
+	int byte_sum(const unsigned char* voice_data);
+
+	/**
+	 * True if byte at given Voice offset is the 8th bit of the next one.
+	 */
+	bool is_overflow_byte(std::size_t offset);
+
+	/**
+	 * Contribution of value at given Voice offset to byte_sum.
+	 */
+	int weighted_byte(std::size_t offset, unsigned char value);
+
+	/**
+	 * Calculate 8-bit checksums of count voices in one go, into out.
+	 * Voices are summed several at a time, sharing the loads of the
+	 * byte masks, and nothing is allocated.
+	 */
+	void checksums(const Voice* voices, std::size_t count, midi::byte_t* out);
+
+	/**
+	 * 64-bit FNV-1a hash of Voice data, checksum excluded. Equal hashes
+	 * mean equal sounds, whatever the checksum bytes say.
+	 */
+	std::uint64_t content_hash(const Voice&);
+
+	Voice make_voice();
+
+	template <class Model = Sy22Model>
+	SingleVoiceDump make_svd(const Voice&);
+
+	/**
+	 * Write a Single Voice Dump of v for given device number to out,
+	 * calculating the Voice checksum and the SysEx checksum while
+	 * copying the data.
+	 */
+	template <class Model = Sy22Model>
+	void encode_svd(const Voice& v, SingleVoiceDump& out,
+			unsigned char device = 0);
+
+	/**
+	 * Copy Voice data out of a dump, checking framing and both
+	 * checksums in the same pass.
+	 */
+	template <class Model = Sy22Model>
+	bool decode_svd(const SingleVoiceDump&, Voice& out);
+
+	const std::size_t bank_voices = 64;
+
+	/**
+	 * All voices of the unit, as the SY22 transmits its voice memory:
+	 * one Single Voice Dump per voice, back to back.
+	 */
+	struct BankDump {
+		SingleVoiceDump voices[bank_voices];
 	};
 
+	/**
+	 * Encode a whole bank into one contiguous buffer, in a single pass
+	 * over the voice data.
+	 */
+	template <class Model = Sy22Model>
+	void encode_bank(const Voice* voices, BankDump& out,
+			unsigned char device = 0);
+
+	/**
+	 * Decode consecutive dumps of a bank from raw data into voices,
+	 * stopping at the first one that isn't valid. Returns the number of
+	 * voices decoded, bank_voices for a complete bank.
+	 */
+	template <class Model = Sy22Model>
+	std::size_t decode_bank(const unsigned char* data, std::size_t size,
+			Voice* voices);
+
+	/**
+	 * Check framing, header, data bytes and both checksums of a Single
+	 * Voice Dump.
+	 */
+	template <class Model = Sy22Model>
+	bool is_valid(const SingleVoiceDump&);
+
+	/**
+	 * True if the framing and header are those of a Single Voice Dump,
+	 * regardless of checksums.
+	 */
+	template <class Model = Sy22Model>
+	bool is_framed(const SingleVoiceDump&);
+
+	/**
+	 * Check the 8-bit Voice checksum.
+	 */
+	bool checksum_ok(const Voice&);
+
+	/**
+	 * Check the 7-bit SysEx checksum of a dump.
+	 */
+	bool sysex_checksum_ok(const SingleVoiceDump&);
+
+	/**
+	 * True if no byte between the start of SysEx and EOX has bit 7 set,
+	 * as MIDI requires of data bytes. The checksums are masked and
+	 * don't notice.
+	 */
+	bool sysex_data_ok(const SingleVoiceDump&);
+
 };
 
 #endif
@@ -0,0 +1,171 @@
+#include <cstring>
+
+#include "SysExParser.h"
+
+namespace sy22 {
+
+	namespace {
+
+		const std::size_t header_size = sizeof(SingleVoiceDump::header);
+		const std::size_t checksum_offset = offsetof(Voice, checksum);
+
+	};
+
+	template <class Model>
+	BasicSysExParser<Model>::BasicSysExParser() :
+		state_(idle),
+		count_(0),
+		pos_(0),
+		sum_(0),
+		voice_sum_(0),
+		voice_() {}
+
+	template <class Model>
+	void BasicSysExParser<Model>::reset() {
+		state_ = idle;
+	}
+
+	template <class Model>
+	bool BasicSysExParser<Model>::receiving() const {
+		return state_ == data || state_ == checksum || state_ == eox;
+	}
+
+	template <class Model>
+	SysExResults::Result BasicSysExParser<Model>::fail() {
+		state_ = ignore;
+		return error;
+	}
+
+	template <class Model>
+	SysExResults::Result BasicSysExParser<Model>::feed(unsigned char byte) {
+		// System real time messages may appear anywhere
+		if (byte >= 0xF8) {
+			return none;
+		}
+
+		if (byte == 0xF0) {
+			// A new message always starts over, abandoning anything
+			// unfinished
+			state_ = manufacturer;
+			return none;
+		}
+
+		if (byte & 0x80) {
+			// End Of Exclusive, or any other status byte, terminates the
+			// message
+			bool complete = byte == 0xF7 && state_ == eox;
+			bool broken = !complete && receiving();
+			state_ = idle;
+			return complete ? voice_received : broken ? error : none;
+		}
+
+		switch (state_) {
+		case idle:
+		case ignore:
+			return none;
+
+		case manufacturer:
+			// Yamaha
+			state_ = byte == 0x43 ? channel : ignore;
+			return none;
+
+		case channel:
+			// Bulk dump, any device number
+			state_ = (byte & 0xF0) == 0x00 ? format : ignore;
+			return none;
+
+		case format:
+			state_ = byte == 0x7E ? count_msb : ignore;
+			return none;
+
+		case count_msb:
+			count_ = byte << 7;
+			state_ = count_lsb;
+			return none;
+
+		case count_lsb:
+			count_ |= byte;
+			if (count_ != header_size + sizeof(Voice)) {
+				// Some other dump type or model sharing the port, not
+				// ours to judge
+				state_ = ignore;
+				return none;
+			}
+			pos_ = 0;
+			sum_ = 0;
+			state_ = header;
+			return none;
+
+		case header:
+			if (byte != static_cast<unsigned char>(Model::header[pos_])) {
+				// Some other bulk dump, not ours
+				state_ = ignore;
+				return none;
+			}
+			sum_ += byte;
+			if (++pos_ == header_size) {
+				pos_ = 0;
+				voice_sum_ = 0;
+				state_ = data;
+			}
+			return none;
+
+		case data:
+			reinterpret_cast<unsigned char*>(&voice_)[pos_] = byte;
+			sum_ += byte;
+			if (pos_ < checksum_offset) {
+				voice_sum_ += weighted_byte(pos_, byte);
+			}
+			if (++pos_ == sizeof(Voice)) {
+				state_ = checksum;
+			}
+			return none;
+
+		case checksum:
+			if (((sum_ + byte) & 0x7F) != 0 ||
+				midi::UChar(voice_.checksum) !=
+				static_cast<unsigned char>(-voice_sum_)) {
+				return fail();
+			}
+			state_ = eox;
+			return none;
+
+		case eox:
+			// Too much data
+			return fail();
+		}
+
+		return none;
+	}
+
+	template <class Model>
+	SysExResults::Result BasicSysExParser<Model>::feed(const unsigned char* data,
+			std::size_t size, std::size_t& consumed) {
+		for (consumed = 0; consumed < size; ) {
+			Result r = feed(data[consumed++]);
+			if (r != none) {
+				return r;
+			}
+		}
+		return none;
+	}
+
+	template class BasicSysExParser<Sy22Model>;
+	template class BasicSysExParser<Sy35Model>;
+
+	BankReceiver::BankReceiver() : count_(0), voices_() {}
+
+	bool BankReceiver::add(const Voice& v) {
+		voices_[count_] = v;
+		if (++count_ < bank_voices) {
+			return false;
+		}
+		count_ = 0;
+		return true;
+	}
+
+	void BankReceiver::reset() {
+		count_ = 0;
+	}
+
+};
@@ -0,0 +1,127 @@
+#ifndef _SYSEX_PARSER_H_
+#define _SYSEX_PARSER_H_ 1
+
+#include <cstddef>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Results of feeding a parser, the same for every model.
+	 */
+	struct SysExResults {
+		enum Result {
+			// Need more data
+			none,
+			// A complete and valid Voice is available from voice()
+			voice_received,
+			// Message was addressed to us but was broken
+			error
+		};
+	};
+
+	/**
+	 * Incremental parser for bulk dumps of given model. Bytes may be
+	 * fed in arbitrary fragments, as hosts tend to split long SysEx
+	 * messages across events and blocks. The header and both checksums
+	 * are verified as data arrives. Works on member storage only, so it
+	 * is safe to use on the audio thread.
+	 */
+	template <class Model>
+	class BasicSysExParser : public SysExResults {
+		public:
+		BasicSysExParser();
+
+		/**
+		 * Consume one byte of MIDI data.
+		 */
+		Result feed(unsigned char byte);
+
+		/**
+		 * Consume size bytes of data, stopping early at the first
+		 * complete dump or error. Number of consumed bytes is stored in
+		 * consumed, so the caller may continue with the rest.
+		 */
+		Result feed(const unsigned char* data, std::size_t size,
+				std::size_t& consumed);
+
+		/**
+		 * Abandon any partial message.
+		 */
+		void reset();
+
+		const Voice& voice() const {
+			return voice_;
+		}
+
+		private:
+		enum State {
+			idle,
+			manufacturer,
+			channel,
+			format,
+			count_msb,
+			count_lsb,
+			header,
+			data,
+			checksum,
+			eox,
+			// Skip until next start of SysEx
+			ignore
+		};
+
+		// A dump addressed to us is in progress
+		bool receiving() const;
+		Result fail();
+
+		State state_;
+		std::size_t count_;
+		std::size_t pos_;
+		// Running 7-bit SysEx checksum
+		int sum_;
+		// Running Voice byte_sum
+		int voice_sum_;
+		Voice voice_;
+	};
+
+	typedef BasicSysExParser<Sy22Model> SysExParser;
+	typedef BasicSysExParser<Sy35Model> Sy35SysExParser;
+
+	/**
+	 * Collects the voices of a bank dump as the parser delivers them.
+	 * The SY22 sends its voice memory as consecutive Single Voice
+	 * Dumps, so the caller resets on a pause that ends a transfer.
+	 */
+	class BankReceiver {
+		public:
+		BankReceiver();
+
+		/**
+		 * Add the next received voice. Returns true when it completes
+		 * a bank, the next voice then starts a new one.
+		 */
+		bool add(const Voice& v);
+
+		void reset();
+
+		std::size_t received() const {
+			return count_;
+		}
+
+		/**
+		 * Voices of the bank just completed by add(). Overwritten as
+		 * the next one arrives.
+		 */
+		const Voice* voices() const {
+			return voices_;
+		}
+
+		private:
+		std::size_t count_;
+		Voice voices_[bank_voices];
+	};
+
+};
+
+#endif
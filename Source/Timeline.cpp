@@ -0,0 +1,47 @@
+#include "Timeline.h"
+
+namespace sy22 {
+
+	static_assert(Timeline::capacity <= 32, "slots are tracked in 32 bits");
+
+	Timeline::Timeline() : count_(0), used_(0) {}
+
+	bool Timeline::add(double beat, std::size_t size, unsigned& slot) {
+		if (count_ == capacity) {
+			return false;
+		}
+
+		slot = 0;
+		while (used_ & (1u << slot)) {
+			slot++;
+		}
+		used_ |= 1u << slot;
+
+		// Insertion sort, events at the same beat keep their order
+		std::size_t i = count_++;
+		for (; i > 0 && events_[i - 1].beat > beat; i--) {
+			events_[i] = events_[i - 1];
+		}
+		events_[i].beat = beat;
+		events_[i].size = size;
+		events_[i].slot = slot;
+		return true;
+	}
+
+	void Timeline::pop() {
+		if (count_ == 0) {
+			return;
+		}
+		used_ &= ~(1u << events_[0].slot);
+		for (std::size_t i = 1; i < count_; i++) {
+			events_[i - 1] = events_[i];
+		}
+		count_--;
+	}
+
+	void Timeline::clear() {
+		count_ = 0;
+		used_ = 0;
+	}
+
+};
@@ -0,0 +1,79 @@
+#ifndef _TIMELINE_H_
+#define _TIMELINE_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sy22 {
+
+	/**
+	 * Messages to be in the device by a given song position, kept in
+	 * beat order. Each gets a payload slot number for the caller's
+	 * storage. Fixed capacity and no allocations, for the audio thread.
+	 */
+	class Timeline {
+		public:
+		static const unsigned capacity = 16;
+
+		struct Event {
+			// Position in quarter notes the message must be sent by
+			double beat;
+			std::size_t size;
+			unsigned slot;
+		};
+
+		Timeline();
+
+		/**
+		 * Add a message of size bytes due at beat. Returns false if the
+		 * timeline is full, otherwise stores the payload slot in slot.
+		 */
+		bool add(double beat, std::size_t size, unsigned& slot);
+
+		/**
+		 * Earliest event, or nullptr if there are none.
+		 */
+		const Event* next() const {
+			return count_ ? &events_[0] : nullptr;
+		}
+
+		/**
+		 * Remove the earliest event and free its slot.
+		 */
+		void pop();
+
+		std::size_t size() const {
+			return count_;
+		}
+
+		void clear();
+
+		/**
+		 * Sample, relative to a block starting at block_beat, by which e
+		 * has to be sent.
+		 */
+		static double target(const Event& e, double block_beat,
+				double samples_per_beat) {
+			return (e.beat - block_beat) * samples_per_beat;
+		}
+
+		/**
+		 * Sample where sending e has to start to finish at its target,
+		 * given the wire time of a byte in samples.
+		 */
+		static double start(const Event& e, double block_beat,
+				double samples_per_beat, double samples_per_byte) {
+			return target(e, block_beat, samples_per_beat) -
+				e.size * samples_per_byte;
+		}
+
+		private:
+		Event events_[capacity];
+		std::size_t count_;
+		// Bit per payload slot in use
+		std::uint32_t used_;
+	};
+
+};
+
+#endif
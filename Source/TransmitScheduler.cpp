@@ -0,0 +1,58 @@
+#include "TransmitScheduler.h"
+
+namespace sy22 {
+
+	TransmitScheduler::TransmitScheduler() :
+		sample_rate_(44100.0),
+		gap_(default_gap_ms / 1000.0),
+		busy_until_(0.0) {}
+
+	void TransmitScheduler::set_sample_rate(double sample_rate) {
+		if (sample_rate > 0.0) {
+			// Keep pending wire time, rescaled to the new rate
+			busy_until_ *= sample_rate / sample_rate_;
+			sample_rate_ = sample_rate;
+		}
+	}
+
+	void TransmitScheduler::set_gap(double seconds) {
+		gap_ = seconds > 0.0 ? seconds : 0.0;
+	}
+
+	long TransmitScheduler::next_slot(long block_size) const {
+		if (busy_until_ <= 0.0) {
+			return 0;
+		}
+		// Round up, sending a sample early could overrun the device
+		long slot = static_cast<long>(busy_until_);
+		if (slot < busy_until_) {
+			slot++;
+		}
+		return slot < block_size ? slot : -1;
+	}
+
+	void TransmitScheduler::sent(long offset, std::size_t size, bool gap) {
+		busy_until_ = offset + duration(size, gap) * sample_rate_;
+	}
+
+	void TransmitScheduler::advance(long block_size) {
+		busy_until_ -= block_size;
+		if (busy_until_ < 0.0) {
+			busy_until_ = 0.0;
+		}
+	}
+
+	double TransmitScheduler::duration(std::size_t size, bool gap) const {
+		return static_cast<double>(size) / bytes_per_second +
+			(gap ? gap_ : 0.0);
+	}
+
+	double TransmitScheduler::busy() const {
+		return busy_until_ / sample_rate_;
+	}
+
+	void TransmitScheduler::reset() {
+		busy_until_ = 0.0;
+	}
+
+};
@@ -0,0 +1,76 @@
+#ifndef _TRANSMIT_SCHEDULER_H_
+#define _TRANSMIT_SCHEDULER_H_ 1
+
+#include <cstddef>
+
+namespace sy22 {
+
+	/**
+	 * Models the MIDI wire and SY22 input so that messages are never
+	 * sent faster than the device can take them in. Time is counted in
+	 * samples, so placement within processBlock is sample accurate.
+	 */
+	class TransmitScheduler {
+		public:
+		// MIDI runs at 31.25 kbaud, a byte takes 10 bits on the wire
+		static const int bytes_per_second = 31250 / 10;
+
+		// Time the SY22 needs to store a bulk dump before it is ready
+		// for the next one
+		static const int default_gap_ms = 100;
+
+		TransmitScheduler();
+
+		void set_sample_rate(double sample_rate);
+		void set_gap(double seconds);
+
+		/**
+		 * Sample offset within a block of given size where the next
+		 * message may go out, or -1 if the wire is busy for the whole
+		 * block.
+		 */
+		long next_slot(long block_size) const;
+
+		/**
+		 * Mark size bytes sent at offset within the current block. If
+		 * gap is set the device gets its processing time afterwards.
+		 */
+		void sent(long offset, std::size_t size, bool gap = true);
+
+		/**
+		 * Move on to the next block.
+		 */
+		void advance(long block_size);
+
+		/**
+		 * Wire time of size bytes plus device gap, in seconds.
+		 */
+		double duration(std::size_t size, bool gap = true) const;
+
+		/**
+		 * The same in samples.
+		 */
+		double duration_samples(std::size_t size, bool gap = true) const {
+			return duration(size, gap) * sample_rate_;
+		}
+
+		/**
+		 * Seconds until the wire is free again.
+		 */
+		double busy() const;
+
+		/**
+		 * Forget any wire activity, e.g. after transport reset.
+		 */
+		void reset();
+
+		private:
+		double sample_rate_;
+		double gap_;
+		// Samples until the wire is free, relative to block start
+		double busy_until_;
+	};
+
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include <cstring>
+
+#include "VoiceDiff.h"
+#include "VoiceFields.h"
+
+namespace sy22 {
+
+	namespace {
+
+		// Checksum and the null before it are not parameters, the
+		// device takes care of those
+		const std::size_t parameter_bytes = offsetof(Voice, null);
+
+		typedef unsigned long long word_t;
+
+		word_t load_word(const unsigned char* p) {
+			word_t w;
+			std::memcpy(&w, p, sizeof(w));
+			return w;
+		}
+
+	};
+
+	ParameterChange make_parameter_change(unsigned char device,
+			std::size_t offset, midi::byte_t value) {
+		return {
+			0xF0,
+			0x43,
+			static_cast<unsigned char>(0x10 | (device & 0x0F)),
+			0x26,
+			0x02,
+			static_cast<unsigned char>((offset >> 7) & 0x7F),
+			static_cast<unsigned char>(offset & 0x7F),
+			static_cast<unsigned char>(value.msb & 0x7F),
+			static_cast<unsigned char>(value.lsb & 0x7F),
+			0xF7
+		};
+	}
+
+	std::size_t diff(const Voice& sent, const Voice& edited,
+			unsigned char device, ParameterChange* changes) {
+		const unsigned char* a = reinterpret_cast<const unsigned char*>(&sent);
+		const unsigned char* b = reinterpret_cast<const unsigned char*>(&edited);
+		std::size_t count = 0;
+		std::size_t i = 0;
+
+		while (i < parameter_bytes) {
+			// Skip over identical data a word at a time
+			if (i + sizeof(word_t) <= parameter_bytes &&
+					load_word(a + i) == load_word(b + i)) {
+				i += sizeof(word_t);
+				continue;
+			}
+
+			if (a[i] == b[i]) {
+				i++;
+				continue;
+			}
+
+			// Fields are addressed by their overflow byte, if they
+			// have one
+			const std::size_t offset = voice_bytes::start[i];
+			const std::size_t width = voice_bytes::width[offset];
+
+			midi::byte_t value = {0, b[offset]};
+			if (width == 2) {
+				value.msb = b[offset];
+				value.lsb = b[offset + 1];
+			}
+
+			if (count == max_parameter_changes) {
+				return full_dump;
+			}
+			changes[count++] = make_parameter_change(device, offset, value);
+			i = offset + width;
+		}
+
+		return count;
+	}
+
+};
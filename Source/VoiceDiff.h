@@ -0,0 +1,58 @@
+#ifndef _VOICE_DIFF_H_
+#define _VOICE_DIFF_H_ 1
+
+#include <cstddef>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * Parameter change message for a single Voice field.
+	 *
+	 * F0 43 1n 26 02 aa aa vv vv F7
+	 *
+	 * n is the device number, aa aa the field offset in Voice data as 7-bit
+	 * MSB/LSB, and vv vv the value. Fields with an overflow byte send it
+	 * as the first value byte, other fields send a zero there.
+	 */
+	struct ParameterChange {
+		unsigned char start_of_sysex;
+		unsigned char manufacturer;
+		unsigned char device;
+		unsigned char group;
+		unsigned char sub_group;
+		unsigned char address_msb;
+		unsigned char address_lsb;
+		unsigned char value_msb;
+		unsigned char value_lsb;
+		unsigned char eox;
+	};
+
+	/**
+	 * Sending this many parameter changes takes as many bytes as a
+	 * whole SingleVoiceDump.
+	 */
+	const std::size_t max_parameter_changes =
+		sizeof(SingleVoiceDump) / sizeof(ParameterChange);
+
+	/**
+	 * Returned by diff when a full dump is cheaper.
+	 */
+	const std::size_t full_dump = static_cast<std::size_t>(-1);
+
+	ParameterChange make_parameter_change(unsigned char device,
+			std::size_t offset, midi::byte_t value);
+
+	/**
+	 * Compare the Voice last sent to the device with an edited one and
+	 * write parameter changes for the differing fields to changes, which
+	 * must have room for max_parameter_changes entries. Returns the number
+	 * of changes, or full_dump if a SingleVoiceDump takes fewer bytes.
+	 */
+	std::size_t diff(const Voice& sent, const Voice& edited,
+			unsigned char device, ParameterChange* changes);
+
+};
+
+#endif
@@ -0,0 +1,314 @@
+#ifndef _VOICE_FIELDS_H_
+#define _VOICE_FIELDS_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Indices.h"
+#include "Sy22.h"
+#include "VoiceParams.h"
+
+/**
+ * Compile-time description of every Voice field, built from the structs
+ * in Sy22.h and VoiceParams.h with offsetof, so it can't drift from
+ * them. The overflow byte masks of the checksum, the field boundaries
+ * diff goes by and the VoiceParams conversion tables are expanded from
+ * it at compile time, and the parameter table is checked against it.
+ */
+namespace sy22 {
+
+	enum FieldEncoding {
+		// 7-bit byte
+		byte_value,
+		// Overflow byte and byte, 0 to 0xFF
+		word_value,
+		// Overflow byte and byte, two's complement
+		signed_word,
+		// Vector X or Y, 0 to 0x3E for -31 to +31
+		position
+	};
+
+	struct FieldInfo {
+		// In Voice data, the overflow byte for fields that have one
+		std::size_t offset;
+		// Of the std::int16_t in VoiceParams
+		std::size_t native;
+		FieldEncoding encoding;
+		std::size_t width;
+		// What the field holds, in VoiceParams units
+		int minimum;
+		int maximum;
+		bool overflow;
+		// Address of the field in a ParameterChange
+		midi::byte_t address;
+	};
+
+	constexpr FieldInfo make_field(std::size_t offset, std::size_t native,
+			FieldEncoding encoding, int minimum, int maximum) {
+		return {
+			offset,
+			native,
+			encoding,
+			encoding == word_value || encoding == signed_word ? 2u : 1u,
+			minimum,
+			maximum,
+			encoding == word_value || encoding == signed_word,
+			{static_cast<unsigned char>((offset >> 7) & 0x7F),
+				static_cast<unsigned char>(offset & 0x7F)}
+		};
+	}
+
+	namespace fields {
+
+// Field of wire struct S at offset W in Voice and its namesake in
+// S##Params at offset N in VoiceParams. Ranges are those of the form
+// document in Sy22.h, bit maps it gives none for take what the
+// encoding holds.
+#define SY22_FIELD(W, N, S, f, e, lo, hi) \
+	make_field((W) + offsetof(S, f), (N) + offsetof(S##Params, f), e, lo, hi)
+
+#define SY22_ENVELOPE_FIELDS(W, N) \
+	SY22_FIELD(W, N, Envelope, level_rate_scaling, word_value, 0, 0xFF), \
+	SY22_FIELD(W, N, Envelope, delay_ar, word_value, 0, 0xFF), \
+	SY22_FIELD(W, N, Envelope, peak_dr1, word_value, 0, 0xFF), \
+	SY22_FIELD(W, N, Envelope, dr2, byte_value, 0, 0x3F), \
+	SY22_FIELD(W, N, Envelope, rr, byte_value, 0, 0x3F), \
+	SY22_FIELD(W, N, Envelope, il, byte_value, 0, 0x7F), \
+	SY22_FIELD(W, N, Envelope, al, byte_value, 0, 0x7F), \
+	SY22_FIELD(W, N, Envelope, dl1, byte_value, 0, 0x7F), \
+	SY22_FIELD(W, N, Envelope, dl2, byte_value, 0, 0x7F)
+
+// FM elements have more depth bits, for the modulator and carrier
+// switches
+#define SY22_LFO_FIELDS(W, N, am, pm) \
+	SY22_FIELD(W, N, LFO, wave_speed, word_value, 0, 0xFF), \
+	SY22_FIELD(W, N, LFO, delay, word_value, 0, 0xFF), \
+	SY22_FIELD(W, N, LFO, rate, word_value, 0, 0xFF), \
+	SY22_FIELD(W, N, LFO, am_depth, byte_value, 0, am), \
+	SY22_FIELD(W, N, LFO, pm_depth, byte_value, 0, pm)
+
+#define SY22_WAVE_FIELDS(W, N) \
+	SY22_FIELD(W, N, Wave, wave, byte_value, 0, 0x7F), \
+	SY22_FIELD(W, N, Wave, pitch_shift, signed_word, -12, 12), \
+	SY22_FIELD(W, N, Wave, velocity_after_touch_response, byte_value, 0, 0x7A), \
+	SY22_LFO_FIELDS((W) + offsetof(Wave, lfo), (N) + offsetof(WaveParams, lfo), \
+			0x1F, 0x3F), \
+	SY22_FIELD(W, N, Wave, env_type_pan, byte_value, 0, 0x7F), \
+	SY22_FIELD(W, N, Wave, tone_volume, byte_value, 0, 0x7F), \
+	SY22_FIELD(W, N, Wave, temperament_detune, byte_value, 0, 0x3F), \
+	SY22_ENVELOPE_FIELDS((W) + offsetof(Wave, env), (N) + offsetof(WaveParams, env))
+
+#define SY22_OPERATOR_FIELDS(W, N) \
+	SY22_FIELD(W, N, Operator, fixed_waveform_freq, word_value, 0, 0xFF), \
+	SY22_FIELD(W, N, Operator, level, byte_value, 0, 0x7F), \
+	SY22_FIELD(W, N, Operator, temperament_detune, byte_value, 0, 0x3F), \
+	SY22_ENVELOPE_FIELDS((W) + offsetof(Operator, env), \
+			(N) + offsetof(OperatorParams, env))
+
+#define SY22_FM_FIELDS(W, N) \
+	SY22_FIELD(W, N, FM, wave, word_value, 0, 0xFF), \
+	SY22_FIELD(W, N, FM, pitch_shift, signed_word, -12, 12), \
+	SY22_FIELD(W, N, FM, velocity_after_touch_response, byte_value, 0, 0x7A), \
+	SY22_LFO_FIELDS((W) + offsetof(FM, lfo), (N) + offsetof(FMParams, lfo), \
+			0x3F, 0x7F), \
+	SY22_FIELD(W, N, FM, env_type_pan, byte_value, 0, 0x7F), \
+	SY22_FIELD(W, N, FM, feedback, byte_value, 0, 7), \
+	SY22_OPERATOR_FIELDS((W) + offsetof(FM, modulator), \
+			(N) + offsetof(FMParams, modulator)), \
+	SY22_OPERATOR_FIELDS((W) + offsetof(FM, carrier), \
+			(N) + offsetof(FMParams, carrier))
+
+#define SY22_ELEMENT(S, e) \
+	SY22_##S##_FIELDS(offsetof(Voice, e), offsetof(VoiceParams, e))
+
+		// Everything up to the vector steps, in Voice order
+		constexpr FieldInfo fixed[] = {
+			SY22_FIELD(0, 0, Voice, effect, byte_value, 0, 0x7F),
+			SY22_FIELD(0, 0, Voice, configuration_pitch_bend, word_value, 0, 0xFF),
+			SY22_FIELD(0, 0, Voice, after_touch_mod_wheel, byte_value, 0, 0x7F),
+			SY22_FIELD(0, 0, Voice, after_touch_pitch_shift, signed_word, -12, 12),
+			SY22_FIELD(0, 0, Voice, env_delay, byte_value, 0, 0x7F),
+			SY22_FIELD(0, 0, Voice, common_ar, signed_word, -64, 63),
+			SY22_FIELD(0, 0, Voice, common_rr, signed_word, -64, 63),
+			SY22_ELEMENT(WAVE, A),
+			SY22_ELEMENT(FM, B),
+			SY22_ELEMENT(WAVE, C),
+			SY22_ELEMENT(FM, D),
+			SY22_FIELD(offsetof(Voice, vector), offsetof(VoiceParams, vector),
+					VectorInfo, level_rate, byte_value, 0, 0x7F),
+			SY22_FIELD(offsetof(Voice, vector), offsetof(VoiceParams, vector),
+					VectorInfo, detune_rate, byte_value, 0, 0x7F)
+		};
+
+#undef SY22_ELEMENT
+#undef SY22_FM_FIELDS
+#undef SY22_OPERATOR_FIELDS
+#undef SY22_WAVE_FIELDS
+#undef SY22_LFO_FIELDS
+#undef SY22_ENVELOPE_FIELDS
+#undef SY22_FIELD
+
+		constexpr std::size_t fixed_count = sizeof(fixed) / sizeof(fixed[0]);
+
+		static_assert(offsetof(VectorInfo, detune) ==
+				offsetof(VectorInfo, level) + sizeof(VectorInfo::level) &&
+				offsetof(VectorInfoParams, detune) ==
+				offsetof(VectorInfoParams, level) + sizeof(VectorInfoParams::level),
+				"vector steps are contiguous");
+
+		constexpr std::size_t step_part(std::size_t part, std::size_t len,
+				std::size_t x, std::size_t y) {
+			return part == 0 ? len : part == 1 ? x : y;
+		}
+
+		// Level and detune steps follow each other, so all 100 are
+		// walked as one array of len, x and y
+		constexpr FieldInfo step(std::size_t i) {
+			return make_field(
+				offsetof(Voice, vector) + offsetof(VectorInfo, level) +
+					i / 3 * sizeof(VectorStep) + step_part(i % 3,
+							offsetof(VectorStep, len), offsetof(VectorStep, x),
+							offsetof(VectorStep, y)),
+				offsetof(VoiceParams, vector) + offsetof(VectorInfoParams, level) +
+					i / 3 * sizeof(VectorStepParams) + step_part(i % 3,
+							offsetof(VectorStepParams, len),
+							offsetof(VectorStepParams, x),
+							offsetof(VectorStepParams, y)),
+				i % 3 == 0 ? word_value : position,
+				i % 3 == 0 ? 0 : -31, i % 3 == 0 ? 0xFF : 31);
+		}
+
+	};
+
+	/**
+	 * Field i of Voice, in Voice order and the order of the numbers of
+	 * VoiceParams. The name is not a field.
+	 */
+	constexpr FieldInfo voice_field(std::size_t i) {
+		return i < fields::fixed_count ? fields::fixed[i] :
+			fields::step(i - fields::fixed_count);
+	}
+
+	const std::size_t voice_field_count = param_fields;
+
+	namespace fields {
+
+		// Next field starts where this one ends, skipping the name
+		constexpr bool adjacent(const FieldInfo& f, const FieldInfo& next) {
+			return next.offset == f.offset + f.width ||
+				(f.offset + f.width == offsetof(Voice, name) &&
+				 next.offset == offsetof(Voice, name) + sizeof(Voice::name));
+		}
+
+		// Field i is the ith int16 of VoiceParams and follows field
+		// i - 1 on the wire, for i in [first, last)
+		constexpr bool in_order(std::size_t first, std::size_t last) {
+			return last - first == 1 ?
+				voice_field(first).native == first * sizeof(std::int16_t) &&
+					(first == 0 ||
+					 adjacent(voice_field(first - 1), voice_field(first))) :
+				in_order(first, first + (last - first) / 2) &&
+					in_order(first + (last - first) / 2, last);
+		}
+
+		static_assert(fixed_count + 3 * (sizeof(VectorInfoParams::level) +
+					sizeof(VectorInfoParams::detune)) / sizeof(VectorStepParams) ==
+				voice_field_count, "a table entry for every VoiceParams field");
+		static_assert(voice_field(0).offset == offsetof(Voice, effect) &&
+				in_order(0, voice_field_count) &&
+				voice_field(voice_field_count - 1).offset + 1 == offsetof(Voice, null),
+				"table covers Voice data in order, but for the name");
+
+		// Index of the last field starting at or before offset, by
+		// binary search in [first, last)
+		constexpr std::size_t find(std::size_t offset, std::size_t first,
+				std::size_t last) {
+			return last - first == 1 ? first :
+				voice_field(first + (last - first) / 2).offset <= offset ?
+					find(offset, first + (last - first) / 2, last) :
+					find(offset, first, first + (last - first) / 2);
+		}
+
+		constexpr bool within(const FieldInfo& f, std::size_t offset) {
+			return f.offset <= offset && offset < f.offset + f.width;
+		}
+
+		constexpr FieldInfo at(std::size_t offset) {
+			return voice_field(find(offset, 0, voice_field_count));
+		}
+
+	};
+
+	/**
+	 * First byte of the field containing the byte at given Voice offset.
+	 * Bytes outside the fields, such as the name, stand for themselves.
+	 */
+	constexpr std::size_t field_start(std::size_t offset) {
+		return fields::within(fields::at(offset), offset) ?
+			fields::at(offset).offset : offset;
+	}
+
+	constexpr std::size_t field_width(std::size_t offset) {
+		return fields::within(fields::at(offset), offset) ?
+			fields::at(offset).offset + fields::at(offset).width - offset : 1;
+	}
+
+	/**
+	 * True if the byte at given Voice offset is the 8th bit of the next.
+	 */
+	constexpr bool overflow_byte(std::size_t offset) {
+		return fields::at(offset).overflow && fields::at(offset).offset == offset;
+	}
+
+	/**
+	 * The same per byte of Voice data, for lookups at run time.
+	 */
+	template <class> struct field_bytes;
+
+	template <std::size_t... I>
+	struct field_bytes<indices<I...>> {
+		static constexpr std::uint16_t start[sizeof...(I)] = {
+			static_cast<std::uint16_t>(field_start(I))...
+		};
+		static constexpr unsigned char width[sizeof...(I)] = {
+			static_cast<unsigned char>(field_width(I))...
+		};
+		static constexpr unsigned char overflow[sizeof...(I)] = {
+			static_cast<unsigned char>(overflow_byte(I) ? 1 : 0)...
+		};
+	};
+
+	template <std::size_t... I>
+	constexpr std::uint16_t field_bytes<indices<I...>>::start[sizeof...(I)];
+	template <std::size_t... I>
+	constexpr unsigned char field_bytes<indices<I...>>::width[sizeof...(I)];
+	template <std::size_t... I>
+	constexpr unsigned char field_bytes<indices<I...>>::overflow[sizeof...(I)];
+
+	// Every byte the checksum covers
+	using voice_bytes = field_bytes<make_indices<offsetof(Voice, checksum)>::type>;
+
+	static_assert(overflow_byte(offsetof(Voice, common_ar)) &&
+			!overflow_byte(offsetof(Voice, common_ar) + 1) &&
+			field_start(offsetof(Voice, D) + offsetof(FM, carrier) + 1) ==
+			offsetof(Voice, D) + offsetof(FM, carrier) &&
+			field_width(offsetof(Voice, name) + 2) == 1 &&
+			overflow_byte(offsetof(Voice, vector) + offsetof(VectorInfo, detune) +
+				49 * sizeof(VectorStep)),
+			"field lookups");
+
+	static_assert(fields::at(offsetof(Voice, B) + offsetof(FM, feedback)).maximum == 7 &&
+			fields::at(offsetof(Voice, common_ar)).minimum == -64 &&
+			fields::at(offsetof(Voice, common_ar)).maximum == 63 &&
+			fields::at(offsetof(Voice, C) + offsetof(Wave, pitch_shift)).minimum == -12 &&
+			fields::at(offsetof(Voice, A) + offsetof(Wave, env) +
+				offsetof(Envelope, rr)).maximum == 0x3F &&
+			fields::at(offsetof(Voice, D) + offsetof(FM, lfo) +
+				offsetof(LFO, am_depth)).maximum == 0x3F &&
+			fields::at(offsetof(Voice, vector) + offsetof(VectorInfo, detune) +
+				offsetof(VectorStep, x)).minimum == -31,
+			"field ranges");
+
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include <cmath>
+
+#include "VoiceFields.h"
+#include "VoiceParameters.h"
+
+namespace sy22 {
+
+	namespace {
+
+		constexpr std::uint16_t common(std::size_t offset) {
+			return static_cast<std::uint16_t>(offset);
+		}
+
+		constexpr std::uint16_t wave(std::size_t element, std::size_t offset) {
+			return static_cast<std::uint16_t>(element + offset);
+		}
+
+		constexpr std::size_t A = offsetof(Voice, A);
+		constexpr std::size_t B = offsetof(Voice, B);
+		constexpr std::size_t C = offsetof(Voice, C);
+		constexpr std::size_t D = offsetof(Voice, D);
+
+		// Offsets within elements
+		constexpr std::size_t wave_lfo = offsetof(Wave, lfo);
+		constexpr std::size_t wave_env = offsetof(Wave, env);
+		constexpr std::size_t fm_lfo = offsetof(FM, lfo);
+		constexpr std::size_t fm_modulator = offsetof(FM, modulator);
+		constexpr std::size_t fm_carrier = offsetof(FM, carrier);
+		constexpr std::size_t carrier_env = fm_carrier + offsetof(Operator, env);
+
+	};
+
+#define SY22_WAVE_PARAMETERS(E, X) \
+	{E " Level", wave(X, offsetof(Wave, tone_volume)), false, 0, 7, 0, 127, true}, \
+	{E " LFO Speed", wave(X, wave_lfo + offsetof(LFO, wave_speed)), true, 0, 5, 0, 31, false}, \
+	{E " LFO Rate", wave(X, wave_lfo + offsetof(LFO, rate)), true, 0, 8, 0, 255, false}, \
+	{E " LFO AM Depth", wave(X, wave_lfo + offsetof(LFO, am_depth)), false, 0, 4, 0, 15, false}, \
+	{E " LFO PM Depth", wave(X, wave_lfo + offsetof(LFO, pm_depth)), false, 0, 5, 0, 31, false}, \
+	{E " Attack Rate", wave(X, wave_env + offsetof(Envelope, delay_ar)), true, 0, 6, 0, 63, false}, \
+	{E " Decay Rate 1", wave(X, wave_env + offsetof(Envelope, peak_dr1)), true, 0, 6, 0, 63, false}, \
+	{E " Release Rate", wave(X, wave_env + offsetof(Envelope, rr)), false, 0, 6, 0, 63, false}
+
+#define SY22_FM_PARAMETERS(E, X) \
+	{E " Level", wave(X, fm_carrier + offsetof(Operator, level)), false, 0, 7, 0, 127, true}, \
+	{E " FM Level", wave(X, fm_modulator + offsetof(Operator, level)), false, 0, 7, 0, 127, false}, \
+	{E " Feedback", wave(X, offsetof(FM, feedback)), false, 0, 3, 0, 7, false}, \
+	{E " LFO Speed", wave(X, fm_lfo + offsetof(LFO, wave_speed)), true, 0, 5, 0, 31, false}, \
+	{E " LFO Rate", wave(X, fm_lfo + offsetof(LFO, rate)), true, 0, 8, 0, 255, false}, \
+	{E " LFO AM Depth", wave(X, fm_lfo + offsetof(LFO, am_depth)), false, 0, 4, 0, 15, false}, \
+	{E " LFO PM Depth", wave(X, fm_lfo + offsetof(LFO, pm_depth)), false, 0, 5, 0, 31, false}, \
+	{E " Attack Rate", wave(X, carrier_env + offsetof(Envelope, delay_ar)), true, 0, 6, 0, 63, false}, \
+	{E " Decay Rate 1", wave(X, carrier_env + offsetof(Envelope, peak_dr1)), true, 0, 6, 0, 63, false}, \
+	{E " Release Rate", wave(X, carrier_env + offsetof(Envelope, rr)), false, 0, 6, 0, 63, false}
+
+	constexpr ParameterInfo parameters[] = {
+		{"Effect Type", common(offsetof(Voice, effect)), false, 0, 4, 0, 15, false},
+		{"Effect Depth", common(offsetof(Voice, effect)), false, 4, 3, 0, 7, false},
+		{"Envelope Delay", common(offsetof(Voice, env_delay)), false, 0, 7, 0, 127, false},
+		{"Attack Rate", common(offsetof(Voice, common_ar)), true, 0, 8, -64, 63, false},
+		{"Release Rate", common(offsetof(Voice, common_rr)), true, 0, 8, -64, 63, false},
+		SY22_WAVE_PARAMETERS("A", A),
+		SY22_FM_PARAMETERS("B", B),
+		SY22_WAVE_PARAMETERS("C", C),
+		SY22_FM_PARAMETERS("D", D)
+	};
+
+#undef SY22_WAVE_PARAMETERS
+#undef SY22_FM_PARAMETERS
+
+	static_assert(sizeof(parameters) / sizeof(parameters[0]) == parameter_count,
+			"parameter_count out of sync with the table");
+
+	namespace {
+
+		// A parameter of a whole field stays in the field's range
+		constexpr bool within_range(const ParameterInfo& p) {
+			return p.shift != 0 ||
+				(p.minimum >= fields::at(p.offset).minimum &&
+				 p.maximum <= fields::at(p.offset).maximum);
+		}
+
+		// Parameters sit at the start of a field and are wide if the
+		// field has an overflow byte, for parameters [first, last)
+		constexpr bool match_fields(std::size_t first, std::size_t last) {
+			return last - first == 1 ?
+				field_start(parameters[first].offset) == parameters[first].offset &&
+					overflow_byte(parameters[first].offset) == parameters[first].wide &&
+					within_range(parameters[first]) :
+				match_fields(first, first + (last - first) / 2) &&
+					match_fields(first + (last - first) / 2, last);
+		}
+
+		static_assert(match_fields(0, parameter_count),
+				"parameters out of sync with the Voice fields");
+
+		int field_value(const Voice& v, const ParameterInfo& p) {
+			const unsigned char* data = reinterpret_cast<const unsigned char*>(&v);
+			return p.wide ? (data[p.offset] << 7) | data[p.offset + 1] :
+				data[p.offset];
+		}
+
+	};
+
+	int get_parameter(const Voice& v, const ParameterInfo& p) {
+		const int mask = (1 << p.bits) - 1;
+		int value = (field_value(v, p) >> p.shift) & mask;
+		if (p.minimum < 0 && value > mask >> 1) {
+			// Sign extend
+			value -= mask + 1;
+		}
+		return value;
+	}
+
+	void set_parameter(Voice& v, const ParameterInfo& p, int value) {
+		value = value < p.minimum ? p.minimum :
+			value > p.maximum ? p.maximum : value;
+
+		const int mask = ((1 << p.bits) - 1) << p.shift;
+		const int field = (field_value(v, p) & ~mask) |
+			((value << p.shift) & mask);
+
+		unsigned char* data = reinterpret_cast<unsigned char*>(&v);
+		if (p.wide) {
+			v.set(reinterpret_cast<midi::byte_t&>(data[p.offset]),
+					midi::byte_t{static_cast<unsigned char>(field >> 7),
+					static_cast<unsigned char>(field & 0x7F)});
+		} else {
+			v.set(data[p.offset], static_cast<unsigned char>(field));
+		}
+	}
+
+	midi::byte_t parameter_field(const Voice& v, const ParameterInfo& p) {
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(&v);
+		if (p.wide) {
+			return {data[p.offset], data[p.offset + 1]};
+		}
+		return {0, data[p.offset]};
+	}
+
+	float to_normalized(const ParameterInfo& p, int value) {
+		float x = static_cast<float>(value - p.minimum) / (p.maximum - p.minimum);
+		return p.inverted ? 1.0f - x : x;
+	}
+
+	int from_normalized(const ParameterInfo& p, float normalized) {
+		float x = normalized < 0.0f ? 0.0f : normalized > 1.0f ? 1.0f : normalized;
+		if (p.inverted) {
+			x = 1.0f - x;
+		}
+		return p.minimum + static_cast<int>(std::floor(x * (p.maximum - p.minimum) + 0.5f));
+	}
+
+};
@@ -0,0 +1,55 @@
+#ifndef _VOICE_PARAMETERS_H_
+#define _VOICE_PARAMETERS_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Sy22.h"
+
+namespace sy22 {
+
+	/**
+	 * A Voice field, or a bit field within one, exposed as a single
+	 * numeric parameter. Fields with an overflow byte are addressed by
+	 * it and read as a 14-bit (msb << 7 | lsb) value.
+	 */
+	struct ParameterInfo {
+		const char* name;
+		std::uint16_t offset;
+		bool wide;
+		unsigned char shift;
+		unsigned char bits;
+		// Stored as two's complement in bits when minimum is negative
+		int minimum;
+		int maximum;
+		// Largest value is the lowest setting, e.g. volume 0 is loudest
+		bool inverted;
+	};
+
+	const std::size_t parameter_count = 41;
+
+	extern const ParameterInfo parameters[];
+
+	int get_parameter(const Voice& v, const ParameterInfo& p);
+
+	/**
+	 * Set a parameter, leaving the rest of a shared field alone and
+	 * keeping the Voice checksum up to date.
+	 */
+	void set_parameter(Voice& v, const ParameterInfo& p, int value);
+
+	/**
+	 * Field containing the parameter, as editVoice style value.
+	 */
+	midi::byte_t parameter_field(const Voice& v, const ParameterInfo& p);
+
+	/**
+	 * Parameter value in 0..1, inverted parameters flipped so that 1
+	 * is always the most.
+	 */
+	float to_normalized(const ParameterInfo& p, int value);
+	int from_normalized(const ParameterInfo& p, float normalized);
+
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "VoiceFields.h"
+#include "VoiceParams.h"
+
+namespace sy22 {
+
+	namespace {
+
+		// Whole AVX2 registers of fields, so the kernels need no scalar
+		// tail. The spare ones point at the null byte and encode as zero.
+		constexpr std::size_t lane_count = (param_fields + 15) & ~15;
+
+		constexpr FieldInfo lane(std::size_t i) {
+			return i < param_fields ? voice_field(i) :
+				make_field(offsetof(Voice, null), 0, byte_value, 0, 0);
+		}
+
+		constexpr std::int16_t sign(std::size_t i) {
+			return lane(i).encoding == signed_word ? 0x80 : 0;
+		}
+
+		constexpr std::int16_t bias(std::size_t i) {
+			return lane(i).encoding == position ? 31 : 0;
+		}
+
+		constexpr std::int16_t maximum(std::size_t i) {
+			return i < param_fields ? lane(i).maximum : 0;
+		}
+
+		/**
+		 * Per-field tables of the conversion kernels. A field is
+		 * gathered from its low byte and, masked to the 8th bit, the
+		 * overflow byte before it. Narrow fields have the same byte as
+		 * both, with the mask zero.
+		 */
+		template <class> struct lane_tables;
+
+		template <std::size_t... I>
+		struct lane_tables<indices<I...>> {
+			static constexpr std::uint16_t low[sizeof...(I)] = {
+				static_cast<std::uint16_t>(lane(I).offset + lane(I).width - 1)...
+			};
+			static constexpr std::uint16_t high[sizeof...(I)] = {
+				static_cast<std::uint16_t>(lane(I).offset)...
+			};
+			static constexpr unsigned char high_mask[sizeof...(I)] = {
+				static_cast<unsigned char>(lane(I).overflow ? 1 : 0)...
+			};
+			static constexpr std::int16_t sign[sizeof...(I)] = {sy22::sign(I)...};
+			static constexpr std::int16_t bias[sizeof...(I)] = {sy22::bias(I)...};
+			static constexpr std::int16_t minimum[sizeof...(I)] = {
+				static_cast<std::int16_t>(lane(I).minimum)...
+			};
+			static constexpr std::int16_t maximum[sizeof...(I)] = {
+				sy22::maximum(I)...
+			};
+		};
+
+		template <std::size_t... I>
+		constexpr std::uint16_t lane_tables<indices<I...>>::low[sizeof...(I)];
+		template <std::size_t... I>
+		constexpr std::uint16_t lane_tables<indices<I...>>::high[sizeof...(I)];
+		template <std::size_t... I>
+		constexpr unsigned char lane_tables<indices<I...>>::high_mask[sizeof...(I)];
+		template <std::size_t... I>
+		constexpr std::int16_t lane_tables<indices<I...>>::sign[sizeof...(I)];
+		template <std::size_t... I>
+		constexpr std::int16_t lane_tables<indices<I...>>::bias[sizeof...(I)];
+		template <std::size_t... I>
+		constexpr std::int16_t lane_tables<indices<I...>>::minimum[sizeof...(I)];
+		template <std::size_t... I>
+		constexpr std::int16_t lane_tables<indices<I...>>::maximum[sizeof...(I)];
+
+		using tables = lane_tables<make_indices<lane_count>::type>;
+
+		/**
+		 * Raw 8-bit field values to numbers, in place:
+		 * (raw ^ sign) - sign - bias.
+		 */
+		void to_numbers(std::int16_t* lanes) {
+			std::size_t i = 0;
+#if defined(__AVX2__)
+			for (; i + 16 <= lane_count; i += 16) {
+				__m256i v = _mm256_load_si256(reinterpret_cast<__m256i*>(lanes + i));
+				__m256i s = _mm256_loadu_si256(
+						reinterpret_cast<const __m256i*>(tables::sign + i));
+				__m256i b = _mm256_loadu_si256(
+						reinterpret_cast<const __m256i*>(tables::bias + i));
+				v = _mm256_sub_epi16(_mm256_sub_epi16(_mm256_xor_si256(v, s), s), b);
+				_mm256_store_si256(reinterpret_cast<__m256i*>(lanes + i), v);
+			}
+#elif defined(__SSE2__)
+			for (; i + 8 <= lane_count; i += 8) {
+				__m128i v = _mm_load_si128(reinterpret_cast<__m128i*>(lanes + i));
+				__m128i s = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(tables::sign + i));
+				__m128i b = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(tables::bias + i));
+				v = _mm_sub_epi16(_mm_sub_epi16(_mm_xor_si128(v, s), s), b);
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes + i), v);
+			}
+#else
+			for (; i < lane_count; i++) {
+				lanes[i] = ((lanes[i] ^ tables::sign[i]) - tables::sign[i]) -
+					tables::bias[i];
+			}
+#endif
+		}
+
+		/**
+		 * Numbers to raw 8-bit field values, in place, clamped to what
+		 * the field holds: (clamp(v) + bias) & 0xFF.
+		 */
+		void to_raw(std::int16_t* lanes) {
+			std::size_t i = 0;
+#if defined(__AVX2__)
+			const __m256i byte = _mm256_set1_epi16(0xFF);
+			for (; i + 16 <= lane_count; i += 16) {
+				__m256i v = _mm256_load_si256(reinterpret_cast<__m256i*>(lanes + i));
+				__m256i lo = _mm256_loadu_si256(
+						reinterpret_cast<const __m256i*>(tables::minimum + i));
+				__m256i hi = _mm256_loadu_si256(
+						reinterpret_cast<const __m256i*>(tables::maximum + i));
+				__m256i b = _mm256_loadu_si256(
+						reinterpret_cast<const __m256i*>(tables::bias + i));
+				v = _mm256_min_epi16(_mm256_max_epi16(v, lo), hi);
+				v = _mm256_and_si256(_mm256_add_epi16(v, b), byte);
+				_mm256_store_si256(reinterpret_cast<__m256i*>(lanes + i), v);
+			}
+#elif defined(__SSE2__)
+			const __m128i byte = _mm_set1_epi16(0xFF);
+			for (; i + 8 <= lane_count; i += 8) {
+				__m128i v = _mm_load_si128(reinterpret_cast<__m128i*>(lanes + i));
+				__m128i lo = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(tables::minimum + i));
+				__m128i hi = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(tables::maximum + i));
+				__m128i b = _mm_loadu_si128(
+						reinterpret_cast<const __m128i*>(tables::bias + i));
+				v = _mm_min_epi16(_mm_max_epi16(v, lo), hi);
+				v = _mm_and_si128(_mm_add_epi16(v, b), byte);
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes + i), v);
+			}
+#else
+			for (; i < lane_count; i++) {
+				const int v = std::min<int>(std::max<int>(lanes[i],
+							tables::minimum[i]), tables::maximum[i]);
+				lanes[i] = static_cast<std::int16_t>((v + tables::bias[i]) & 0xFF);
+			}
+#endif
+		}
+
+	};
+
+	void decode_params(const Voice* voices, VoiceParams* out, std::size_t count) {
+		alignas(32) std::int16_t lanes[lane_count];
+
+		for (std::size_t n = 0; n < count; n++) {
+			const unsigned char* data =
+				reinterpret_cast<const unsigned char*>(&voices[n]);
+			for (std::size_t i = 0; i < lane_count; i++) {
+				lanes[i] = static_cast<std::int16_t>(
+						((data[tables::high[i]] & tables::high_mask[i]) << 7) |
+						(data[tables::low[i]] & 0x7F));
+			}
+			to_numbers(lanes);
+
+			std::memcpy(&out[n], lanes, param_fields * sizeof(std::int16_t));
+			std::memcpy(out[n].name, voices[n].name, sizeof(out[n].name));
+		}
+	}
+
+	void encode_params(const VoiceParams* params, Voice* out, std::size_t count) {
+		alignas(32) std::int16_t lanes[lane_count];
+		std::fill(lanes + param_fields, lanes + lane_count, 0);
+
+		for (std::size_t n = 0; n < count; n++) {
+			std::memcpy(lanes, &params[n], param_fields * sizeof(std::int16_t));
+			to_raw(lanes);
+
+			Voice& v = out[n];
+			v = make_voice();
+			unsigned char* data = reinterpret_cast<unsigned char*>(&v);
+			for (std::size_t i = 0; i < lane_count; i++) {
+				// Narrow fields get their zero high byte overwritten
+				data[tables::high[i]] = static_cast<unsigned char>(
+						(lanes[i] >> 7) & tables::high_mask[i]);
+				data[tables::low[i]] = static_cast<unsigned char>(lanes[i] & 0x7F);
+			}
+			std::memcpy(v.name, params[n].name, sizeof(v.name));
+			v.update_checksum();
+		}
+	}
+
+	VoiceParams to_params(const Voice& v) {
+		VoiceParams p;
+		decode_params(&v, &p, 1);
+		return p;
+	}
+
+	Voice to_voice(const VoiceParams& p) {
+		Voice v;
+		encode_params(&p, &v, 1);
+		return v;
+	}
+
+};
@@ -0,0 +1,135 @@
+#ifndef _VOICE_PARAMS_H_
+#define _VOICE_PARAMS_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Sy22.h"
+
+/**
+ * Voice data as plain numbers. Every field of the wire structs in
+ * Sy22.h has a std::int16_t of the same name here, overflow byte pairs
+ * joined into one 8-bit value, signed fields sign extended and vector
+ * positions centred on zero. Bit fields such as env_type_pan are kept
+ * packed, as on the wire. The name is the only non-numeric field and
+ * comes last, so the numbers form one array of param_fields values.
+ */
+namespace sy22 {
+
+	// Vector step lengths with a special meaning
+	const int vector_step_repeat = 0xFE;
+	const int vector_step_end = 0xFF;
+
+	struct EnvelopeParams {
+		std::int16_t level_rate_scaling;
+		std::int16_t delay_ar;
+		std::int16_t peak_dr1;
+		std::int16_t dr2;
+		std::int16_t rr;
+		std::int16_t il;
+		std::int16_t al;
+		std::int16_t dl1;
+		std::int16_t dl2;
+	};
+
+	struct LFOParams {
+		std::int16_t wave_speed;
+		std::int16_t delay;
+		std::int16_t rate;
+		std::int16_t am_depth;
+		std::int16_t pm_depth;
+	};
+
+	struct WaveParams {
+		std::int16_t wave;
+		// -12 to +12
+		std::int16_t pitch_shift;
+		std::int16_t velocity_after_touch_response;
+		LFOParams lfo;
+		std::int16_t env_type_pan;
+		std::int16_t tone_volume;
+		std::int16_t temperament_detune;
+		EnvelopeParams env;
+	};
+
+	struct OperatorParams {
+		std::int16_t fixed_waveform_freq;
+		std::int16_t level;
+		std::int16_t temperament_detune;
+		EnvelopeParams env;
+	};
+
+	struct FMParams {
+		std::int16_t wave;
+		// -12 to +12
+		std::int16_t pitch_shift;
+		std::int16_t velocity_after_touch_response;
+		LFOParams lfo;
+		std::int16_t env_type_pan;
+		std::int16_t feedback;
+		OperatorParams modulator;
+		OperatorParams carrier;
+	};
+
+	struct VectorStepParams {
+		// vector_step_repeat and vector_step_end, or a length
+		std::int16_t len;
+		// -31 to +31
+		std::int16_t x;
+		std::int16_t y;
+	};
+
+	struct VectorInfoParams {
+		std::int16_t level_rate;
+		std::int16_t detune_rate;
+		VectorStepParams level[50];
+		VectorStepParams detune[50];
+	};
+
+	struct VoiceParams {
+		std::int16_t effect;
+		std::int16_t configuration_pitch_bend;
+		std::int16_t after_touch_mod_wheel;
+		// -12 to +12
+		std::int16_t after_touch_pitch_shift;
+		std::int16_t env_delay;
+		// -64 to +63
+		std::int16_t common_ar;
+		std::int16_t common_rr;
+		WaveParams A;
+		FMParams B;
+		WaveParams C;
+		FMParams D;
+		VectorInfoParams vector;
+		char name[8];
+	};
+
+	// Numeric fields of VoiceParams, in Voice order
+	const std::size_t param_fields = offsetof(VoiceParams, name) /
+		sizeof(std::int16_t);
+
+	static_assert(param_fields == 417, "VoiceParams has a field per Voice field");
+	static_assert(sizeof(VoiceParams) == param_fields * sizeof(std::int16_t) +
+			sizeof(Voice::name), "VoiceParams has no padding");
+	static_assert(alignof(VoiceParams) == alignof(std::int16_t),
+			"VoiceParams is an array of int16");
+
+	/**
+	 * Decode count voices into plain numbers. Fields are gathered by a
+	 * compile-time table and converted 8 or 16 at a time where SIMD is
+	 * available.
+	 */
+	void decode_params(const Voice* voices, VoiceParams* out, std::size_t count);
+
+	/**
+	 * Encode count voices from plain numbers, clamping every value to
+	 * what its field can hold and calculating the checksum.
+	 */
+	void encode_params(const VoiceParams* params, Voice* out, std::size_t count);
+
+	VoiceParams to_params(const Voice& v);
+	Voice to_voice(const VoiceParams& p);
+
+};
+
+#endif
@@ -0,0 +1,350 @@
+#ifndef _VOICE_VIEW_H_
+#define _VOICE_VIEW_H_ 1
+
+#include <cstddef>
+
+#include "Sy22.h"
+#include "VoiceFields.h"
+
+/**
+ * Views over raw Voice data, e.g. straight in a received SysEx buffer or
+ * a memory mapped .syx file. Fields are found at the offsets of the
+ * structs in Sy22.h, as in VoiceFields.h, and decoded only when
+ * accessed. BasicXxxView<const unsigned char> is read-only,
+ * BasicXxxView<unsigned char> can also write fields.
+ */
+namespace sy22 {
+
+	// Field offsets within each struct, the same ones the VoiceFields
+	// table is built from
+	struct EnvelopeLayout {
+		static constexpr std::size_t level_rate_scaling = offsetof(Envelope, level_rate_scaling);
+		static constexpr std::size_t delay_ar = offsetof(Envelope, delay_ar);
+		static constexpr std::size_t peak_dr1 = offsetof(Envelope, peak_dr1);
+		static constexpr std::size_t dr2 = offsetof(Envelope, dr2);
+		static constexpr std::size_t rr = offsetof(Envelope, rr);
+		static constexpr std::size_t il = offsetof(Envelope, il);
+		static constexpr std::size_t al = offsetof(Envelope, al);
+		static constexpr std::size_t dl1 = offsetof(Envelope, dl1);
+		static constexpr std::size_t dl2 = offsetof(Envelope, dl2);
+		static constexpr std::size_t size = sizeof(Envelope);
+	};
+
+	struct LFOLayout {
+		static constexpr std::size_t wave_speed = offsetof(LFO, wave_speed);
+		static constexpr std::size_t delay = offsetof(LFO, delay);
+		static constexpr std::size_t rate = offsetof(LFO, rate);
+		static constexpr std::size_t am_depth = offsetof(LFO, am_depth);
+		static constexpr std::size_t pm_depth = offsetof(LFO, pm_depth);
+		static constexpr std::size_t size = sizeof(LFO);
+	};
+
+	struct WaveLayout {
+		static constexpr std::size_t wave = offsetof(Wave, wave);
+		static constexpr std::size_t pitch_shift = offsetof(Wave, pitch_shift);
+		static constexpr std::size_t velocity_after_touch_response =
+			offsetof(Wave, velocity_after_touch_response);
+		static constexpr std::size_t lfo = offsetof(Wave, lfo);
+		static constexpr std::size_t env_type_pan = offsetof(Wave, env_type_pan);
+		static constexpr std::size_t tone_volume = offsetof(Wave, tone_volume);
+		static constexpr std::size_t temperament_detune = offsetof(Wave, temperament_detune);
+		static constexpr std::size_t env = offsetof(Wave, env);
+		static constexpr std::size_t size = sizeof(Wave);
+	};
+
+	struct OperatorLayout {
+		static constexpr std::size_t fixed_waveform_freq = offsetof(Operator, fixed_waveform_freq);
+		static constexpr std::size_t level = offsetof(Operator, level);
+		static constexpr std::size_t temperament_detune = offsetof(Operator, temperament_detune);
+		static constexpr std::size_t env = offsetof(Operator, env);
+		static constexpr std::size_t size = sizeof(Operator);
+	};
+
+	struct FMLayout {
+		static constexpr std::size_t wave = offsetof(FM, wave);
+		static constexpr std::size_t pitch_shift = offsetof(FM, pitch_shift);
+		static constexpr std::size_t velocity_after_touch_response =
+			offsetof(FM, velocity_after_touch_response);
+		static constexpr std::size_t lfo = offsetof(FM, lfo);
+		static constexpr std::size_t env_type_pan = offsetof(FM, env_type_pan);
+		static constexpr std::size_t feedback = offsetof(FM, feedback);
+		static constexpr std::size_t modulator = offsetof(FM, modulator);
+		static constexpr std::size_t carrier = offsetof(FM, carrier);
+		static constexpr std::size_t size = sizeof(FM);
+	};
+
+	struct VectorStepLayout {
+		static constexpr std::size_t len = offsetof(VectorStep, len);
+		static constexpr std::size_t x = offsetof(VectorStep, x);
+		static constexpr std::size_t y = offsetof(VectorStep, y);
+		static constexpr std::size_t size = sizeof(VectorStep);
+	};
+
+	struct VectorInfoLayout {
+		static constexpr std::size_t level_rate = offsetof(VectorInfo, level_rate);
+		static constexpr std::size_t detune_rate = offsetof(VectorInfo, detune_rate);
+		static constexpr std::size_t level = offsetof(VectorInfo, level);
+		static constexpr std::size_t detune = offsetof(VectorInfo, detune);
+		static constexpr std::size_t steps = sizeof(VectorInfo::level) / sizeof(VectorStep);
+		static constexpr std::size_t size = sizeof(VectorInfo);
+	};
+
+	struct VoiceLayout {
+		static constexpr std::size_t reserved_0 = offsetof(Voice, reserved_0);
+		static constexpr std::size_t reserved_1 = offsetof(Voice, reserved_1);
+		static constexpr std::size_t effect = offsetof(Voice, effect);
+		static constexpr std::size_t name = offsetof(Voice, name);
+		static constexpr std::size_t configuration_pitch_bend =
+			offsetof(Voice, configuration_pitch_bend);
+		static constexpr std::size_t after_touch_mod_wheel = offsetof(Voice, after_touch_mod_wheel);
+		static constexpr std::size_t after_touch_pitch_shift =
+			offsetof(Voice, after_touch_pitch_shift);
+		static constexpr std::size_t env_delay = offsetof(Voice, env_delay);
+		static constexpr std::size_t common_ar = offsetof(Voice, common_ar);
+		static constexpr std::size_t common_rr = offsetof(Voice, common_rr);
+		static constexpr std::size_t A = offsetof(Voice, A);
+		static constexpr std::size_t B = offsetof(Voice, B);
+		static constexpr std::size_t C = offsetof(Voice, C);
+		static constexpr std::size_t D = offsetof(Voice, D);
+		static constexpr std::size_t vector = offsetof(Voice, vector);
+		static constexpr std::size_t null = offsetof(Voice, null);
+		static constexpr std::size_t checksum = offsetof(Voice, checksum);
+		static constexpr std::size_t size = sizeof(Voice);
+	};
+
+	struct SingleVoiceDumpLayout {
+		static constexpr std::size_t header = offsetof(SingleVoiceDump, header);
+		static constexpr std::size_t voice_data = offsetof(SingleVoiceDump, voice_data);
+		static constexpr std::size_t checksum = offsetof(SingleVoiceDump, checksum);
+		static constexpr std::size_t size = sizeof(SingleVoiceDump);
+	};
+
+	// The word getters read the fields the table has overflow bytes for
+	static_assert(overflow_byte(VoiceLayout::common_ar) &&
+			overflow_byte(VoiceLayout::B + FMLayout::wave) &&
+			overflow_byte(VoiceLayout::D + FMLayout::carrier +
+				OperatorLayout::env + EnvelopeLayout::peak_dr1) &&
+			!overflow_byte(VoiceLayout::B + FMLayout::feedback) &&
+			field_start(VoiceLayout::vector + VectorInfoLayout::detune +
+				VectorStepLayout::y) ==
+			VoiceLayout::vector + VectorInfoLayout::detune + VectorStepLayout::y,
+			"VoiceView layout");
+
+	/**
+	 * Common part of all views: a pointer and raw field access.
+	 */
+	template <class T>
+	class BasicView {
+		public:
+		explicit BasicView(T* data) : data_(data) {}
+
+		T* data() const {
+			return data_;
+		}
+
+		protected:
+		unsigned char byte(std::size_t offset) const {
+			return data_[offset];
+		}
+
+		midi::byte_t word(std::size_t offset) const {
+			return {data_[offset], data_[offset + 1]};
+		}
+
+		void set_byte(std::size_t offset, unsigned char value) const {
+			data_[offset] = value;
+		}
+
+		void set_word(std::size_t offset, midi::byte_t value) const {
+			data_[offset] = value.msb;
+			data_[offset + 1] = value.lsb;
+		}
+
+		T* data_;
+	};
+
+// Getter and setter pair for a field of given Layout. Setters only
+// compile for mutable views.
+#define SY22_VIEW_BYTE(Layout, field) \
+		unsigned char field() const { return this->byte(Layout::field); } \
+		void field(unsigned char v) const { this->set_byte(Layout::field, v); }
+
+#define SY22_VIEW_WORD(Layout, field) \
+		midi::byte_t field() const { return this->word(Layout::field); } \
+		void field(midi::byte_t v) const { this->set_word(Layout::field, v); }
+
+#define SY22_VIEW_CHILD(Layout, View, field) \
+		View<T> field() const { return View<T>(this->data_ + Layout::field); }
+
+	template <class T>
+	class BasicEnvelopeView : public BasicView<T> {
+		public:
+		explicit BasicEnvelopeView(T* data) : BasicView<T>(data) {}
+
+		SY22_VIEW_WORD(EnvelopeLayout, level_rate_scaling)
+		SY22_VIEW_WORD(EnvelopeLayout, delay_ar)
+		SY22_VIEW_WORD(EnvelopeLayout, peak_dr1)
+		SY22_VIEW_BYTE(EnvelopeLayout, dr2)
+		SY22_VIEW_BYTE(EnvelopeLayout, rr)
+		SY22_VIEW_BYTE(EnvelopeLayout, il)
+		SY22_VIEW_BYTE(EnvelopeLayout, al)
+		SY22_VIEW_BYTE(EnvelopeLayout, dl1)
+		SY22_VIEW_BYTE(EnvelopeLayout, dl2)
+	};
+
+	template <class T>
+	class BasicLFOView : public BasicView<T> {
+		public:
+		explicit BasicLFOView(T* data) : BasicView<T>(data) {}
+
+		SY22_VIEW_WORD(LFOLayout, wave_speed)
+		SY22_VIEW_WORD(LFOLayout, delay)
+		SY22_VIEW_WORD(LFOLayout, rate)
+		SY22_VIEW_BYTE(LFOLayout, am_depth)
+		SY22_VIEW_BYTE(LFOLayout, pm_depth)
+	};
+
+	template <class T>
+	class BasicWaveView : public BasicView<T> {
+		public:
+		explicit BasicWaveView(T* data) : BasicView<T>(data) {}
+
+		SY22_VIEW_BYTE(WaveLayout, wave)
+		SY22_VIEW_WORD(WaveLayout, pitch_shift)
+		SY22_VIEW_BYTE(WaveLayout, velocity_after_touch_response)
+		SY22_VIEW_CHILD(WaveLayout, BasicLFOView, lfo)
+		SY22_VIEW_BYTE(WaveLayout, env_type_pan)
+		SY22_VIEW_BYTE(WaveLayout, tone_volume)
+		SY22_VIEW_BYTE(WaveLayout, temperament_detune)
+		SY22_VIEW_CHILD(WaveLayout, BasicEnvelopeView, env)
+	};
+
+	template <class T>
+	class BasicOperatorView : public BasicView<T> {
+		public:
+		explicit BasicOperatorView(T* data) : BasicView<T>(data) {}
+
+		SY22_VIEW_WORD(OperatorLayout, fixed_waveform_freq)
+		SY22_VIEW_BYTE(OperatorLayout, level)
+		SY22_VIEW_BYTE(OperatorLayout, temperament_detune)
+		SY22_VIEW_CHILD(OperatorLayout, BasicEnvelopeView, env)
+	};
+
+	template <class T>
+	class BasicFMView : public BasicView<T> {
+		public:
+		explicit BasicFMView(T* data) : BasicView<T>(data) {}
+
+		SY22_VIEW_WORD(FMLayout, wave)
+		SY22_VIEW_WORD(FMLayout, pitch_shift)
+		SY22_VIEW_BYTE(FMLayout, velocity_after_touch_response)
+		SY22_VIEW_CHILD(FMLayout, BasicLFOView, lfo)
+		SY22_VIEW_BYTE(FMLayout, env_type_pan)
+		SY22_VIEW_BYTE(FMLayout, feedback)
+		SY22_VIEW_CHILD(FMLayout, BasicOperatorView, modulator)
+		SY22_VIEW_CHILD(FMLayout, BasicOperatorView, carrier)
+	};
+
+	template <class T>
+	class BasicVectorStepView : public BasicView<T> {
+		public:
+		explicit BasicVectorStepView(T* data) : BasicView<T>(data) {}
+
+		SY22_VIEW_WORD(VectorStepLayout, len)
+		SY22_VIEW_BYTE(VectorStepLayout, x)
+		SY22_VIEW_BYTE(VectorStepLayout, y)
+	};
+
+	template <class T>
+	class BasicVectorInfoView : public BasicView<T> {
+		public:
+		explicit BasicVectorInfoView(T* data) : BasicView<T>(data) {}
+
+		SY22_VIEW_BYTE(VectorInfoLayout, level_rate)
+		SY22_VIEW_BYTE(VectorInfoLayout, detune_rate)
+
+		BasicVectorStepView<T> level(std::size_t step) const {
+			return BasicVectorStepView<T>(this->data_ +
+					VectorInfoLayout::level + step * VectorStepLayout::size);
+		}
+
+		BasicVectorStepView<T> detune(std::size_t step) const {
+			return BasicVectorStepView<T>(this->data_ +
+					VectorInfoLayout::detune + step * VectorStepLayout::size);
+		}
+	};
+
+	template <class T>
+	class BasicVoiceView : public BasicView<T> {
+		public:
+		explicit BasicVoiceView(T* data) : BasicView<T>(data) {}
+
+		/**
+		 * View Voice data of a raw Single Voice Dump.
+		 */
+		static BasicVoiceView from_dump(T* svd) {
+			return BasicVoiceView(svd + SingleVoiceDumpLayout::voice_data);
+		}
+
+		SY22_VIEW_BYTE(VoiceLayout, reserved_0)
+		SY22_VIEW_BYTE(VoiceLayout, reserved_1)
+		SY22_VIEW_BYTE(VoiceLayout, effect)
+
+		/**
+		 * 8 characters, not terminated.
+		 */
+		T* name() const {
+			return this->data_ + VoiceLayout::name;
+		}
+
+		SY22_VIEW_WORD(VoiceLayout, configuration_pitch_bend)
+		SY22_VIEW_BYTE(VoiceLayout, after_touch_mod_wheel)
+		SY22_VIEW_WORD(VoiceLayout, after_touch_pitch_shift)
+		SY22_VIEW_BYTE(VoiceLayout, env_delay)
+		SY22_VIEW_WORD(VoiceLayout, common_ar)
+		SY22_VIEW_WORD(VoiceLayout, common_rr)
+		SY22_VIEW_CHILD(VoiceLayout, BasicWaveView, A)
+		SY22_VIEW_CHILD(VoiceLayout, BasicFMView, B)
+		SY22_VIEW_CHILD(VoiceLayout, BasicWaveView, C)
+		SY22_VIEW_CHILD(VoiceLayout, BasicFMView, D)
+		SY22_VIEW_CHILD(VoiceLayout, BasicVectorInfoView, vector)
+		SY22_VIEW_BYTE(VoiceLayout, null)
+		SY22_VIEW_WORD(VoiceLayout, checksum)
+
+		int byte_sum() const {
+			return sy22::byte_sum(this->data_);
+		}
+
+		bool checksum_ok() const {
+			return midi::UChar(checksum()) ==
+				static_cast<unsigned char>(-byte_sum());
+		}
+
+		void update_checksum() const {
+			checksum(midi::UChar(-byte_sum()));
+		}
+
+		/**
+		 * Copy out into a Voice struct.
+		 */
+		Voice decode() const {
+			Voice v;
+			const T* p = this->data_;
+			unsigned char* out = reinterpret_cast<unsigned char*>(&v);
+			for (std::size_t i = 0; i < VoiceLayout::size; i++) {
+				out[i] = p[i];
+			}
+			return v;
+		}
+	};
+
+#undef SY22_VIEW_BYTE
+#undef SY22_VIEW_WORD
+#undef SY22_VIEW_CHILD
+
+	typedef BasicVoiceView<const unsigned char> VoiceView;
+	typedef BasicVoiceView<unsigned char> MutableVoiceView;
+
+};
+
+#endif
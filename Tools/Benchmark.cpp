@@ -0,0 +1,272 @@
+/**
+ * Throughput of the sy22 core codecs.
+ *
+ * Usage: sy22-bench [--tsv] [--voices N] [file.syx ...]
+ *
+ * Without files a bank of N random voices is used, otherwise all valid
+ * voices found in the given files. --tsv prints one tab separated line
+ * per benchmark (name, voices, ns/voice, MB/s) for tracking regressions.
+ * For the preview engine voices are notes, ns/voice is the time to
+ * render one second of a note and MB/s counts float output.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Librarian.h"
+#include "PreviewSynth.h"
+#include "VoiceParams.h"
+#include "Sy22.h"
+#include "SysExParser.h"
+
+namespace {
+
+	typedef std::chrono::steady_clock clock_type;
+
+	// Keep results alive so the work is not optimized away
+	volatile int sink;
+
+	struct Result {
+		const char* name;
+		std::size_t voices;
+		double ns_per_voice;
+		double mb_per_s;
+	};
+
+	/**
+	 * Run body(voices) repeatedly for at least min_seconds and report the
+	 * best round. bytes is the amount of data one voice processes.
+	 */
+	template <class Body>
+	Result measure(const char* name, std::size_t voices, std::size_t bytes,
+			Body body) {
+		const double min_seconds = 0.25;
+		double best = 1e300;
+		double total = 0;
+		int rounds = 0;
+
+		while (total < min_seconds || rounds < 3) {
+			clock_type::time_point start = clock_type::now();
+			body();
+			std::chrono::duration<double> elapsed = clock_type::now() - start;
+			total += elapsed.count();
+			best = std::min(best, elapsed.count());
+			rounds++;
+		}
+
+		Result r;
+		r.name = name;
+		r.voices = voices;
+		r.ns_per_voice = best * 1e9 / voices;
+		r.mb_per_s = voices * bytes / best / 1e6;
+		return r;
+	}
+
+	std::vector<sy22::Voice> random_voices(std::size_t count) {
+		std::mt19937 rng(22);
+		std::vector<sy22::Voice> voices(count);
+		for (sy22::Voice& v : voices) {
+			unsigned char* p = reinterpret_cast<unsigned char*>(&v);
+			for (std::size_t i = 0; i < sizeof(sy22::Voice); i++) {
+				p[i] = rng() & 0x7F;
+			}
+			v.update_checksum();
+		}
+		return voices;
+	}
+
+	std::vector<sy22::Voice> load_voices(int argc, char** argv, int first) {
+		sy22::Librarian library;
+		for (int i = first; i < argc; i++) {
+			if (!library.add(argv[i])) {
+				std::fprintf(stderr, "sy22-bench: cannot read %s\n", argv[i]);
+			}
+		}
+		std::vector<sy22::Voice> voices;
+		voices.reserve(library.size());
+		for (std::size_t i = 0; i < library.size(); i++) {
+			voices.push_back(library.voice(i));
+		}
+		return voices;
+	}
+
+	void print(const std::vector<Result>& results, bool tsv) {
+		if (!tsv) {
+			std::printf("%-16s %8s %12s %10s\n", "benchmark", "voices",
+					"ns/voice", "MB/s");
+		}
+		for (const Result& r : results) {
+			std::printf(tsv ? "%s\t%zu\t%.2f\t%.2f\n" : "%-16s %8zu %12.2f %10.2f\n",
+					r.name, r.voices, r.ns_per_voice, r.mb_per_s);
+		}
+	}
+
+};
+
+int main(int argc, char** argv) {
+	bool tsv = false;
+	std::size_t count = 4096;
+	int first = 1;
+
+	for (; first < argc && argv[first][0] == '-'; first++) {
+		if (std::strcmp(argv[first], "--tsv") == 0) {
+			tsv = true;
+		} else if (std::strcmp(argv[first], "--voices") == 0 && first + 1 < argc) {
+			count = std::strtoul(argv[++first], nullptr, 10);
+		} else {
+			std::fprintf(stderr,
+					"usage: sy22-bench [--tsv] [--voices N] [file.syx ...]\n");
+			return 2;
+		}
+	}
+
+	std::vector<sy22::Voice> voices = first < argc ?
+		load_voices(argc, argv, first) : random_voices(count);
+
+	if (voices.empty()) {
+		std::fprintf(stderr, "sy22-bench: no voices\n");
+		return 1;
+	}
+
+	const std::size_t n = voices.size();
+	std::vector<sy22::SingleVoiceDump> dumps(n);
+	for (std::size_t i = 0; i < n; i++) {
+		dumps[i] = sy22::make_svd(voices[i]);
+	}
+	const unsigned char* stream = reinterpret_cast<const unsigned char*>(dumps.data());
+	const std::size_t stream_size = n * sizeof(sy22::SingleVoiceDump);
+
+	std::vector<Result> results;
+
+	results.push_back(measure("byte_sum", n, sizeof(sy22::Voice), [&] {
+		int sum = 0;
+		for (const sy22::Voice& v : voices) {
+			sum += sy22::byte_sum(v);
+		}
+		sink = sum;
+	}));
+
+	std::vector<midi::byte_t> sums(n);
+	results.push_back(measure("checksums", n, sizeof(sy22::Voice), [&] {
+		sy22::checksums(voices.data(), n, sums.data());
+		sink = sums[0].lsb;
+	}));
+
+	results.push_back(measure("update_checksum", n, sizeof(sy22::Voice), [&] {
+		for (sy22::Voice& v : voices) {
+			v.update_checksum();
+		}
+		sink = voices[0].checksum.lsb;
+	}));
+
+	results.push_back(measure("make_svd", n, sizeof(sy22::SingleVoiceDump), [&] {
+		for (std::size_t i = 0; i < n; i++) {
+			dumps[i] = sy22::make_svd(voices[i]);
+		}
+		sink = dumps[0].checksum;
+	}));
+
+	results.push_back(measure("is_valid", n, sizeof(sy22::SingleVoiceDump), [&] {
+		int valid = 0;
+		for (const sy22::SingleVoiceDump& d : dumps) {
+			valid += sy22::is_valid(d);
+		}
+		sink = valid;
+	}));
+
+	results.push_back(measure("parse", n, sizeof(sy22::SingleVoiceDump), [&] {
+		sy22::SysExParser parser;
+		std::size_t offset = 0;
+		int received = 0;
+		while (offset < stream_size) {
+			std::size_t consumed = 0;
+			if (parser.feed(stream + offset, stream_size - offset, consumed) ==
+					sy22::SysExParser::voice_received) {
+				received++;
+			}
+			offset += consumed;
+		}
+		sink = received;
+	}));
+
+	// Whole banks only, the rest of the voices are left out
+	const std::size_t banks = n / sy22::bank_voices;
+	if (banks > 0) {
+		const std::size_t bank_n = banks * sy22::bank_voices;
+		std::vector<sy22::BankDump> bank_dumps(banks);
+		std::vector<sy22::Voice> decoded(bank_n);
+
+		results.push_back(measure("encode_bank", bank_n,
+					sizeof(sy22::SingleVoiceDump), [&] {
+			for (std::size_t b = 0; b < banks; b++) {
+				sy22::encode_bank(&voices[b * sy22::bank_voices], bank_dumps[b]);
+			}
+			sink = bank_dumps[0].voices[0].checksum;
+		}));
+
+		results.push_back(measure("decode_bank", bank_n,
+					sizeof(sy22::SingleVoiceDump), [&] {
+			std::size_t count = 0;
+			for (std::size_t b = 0; b < banks; b++) {
+				count += sy22::decode_bank(
+						reinterpret_cast<const unsigned char*>(&bank_dumps[b]),
+						sizeof(sy22::BankDump), &decoded[b * sy22::bank_voices]);
+			}
+			sink = static_cast<int>(count);
+		}));
+	}
+
+	{
+		std::vector<sy22::VoiceParams> params(n);
+
+		results.push_back(measure("decode_params", n, sizeof(sy22::Voice), [&] {
+			sy22::decode_params(voices.data(), params.data(), n);
+			sink = params[0].common_ar;
+		}));
+
+		results.push_back(measure("encode_params", n, sizeof(sy22::Voice), [&] {
+			sy22::encode_params(params.data(), voices.data(), n);
+			sink = voices[0].checksum.lsb;
+		}));
+	}
+
+	// A dozen four element notes of the first voice, one second at
+	// 48 kHz in 64 sample blocks
+	{
+		const double sample_rate = 48000.0;
+		const std::size_t notes = 12;
+		const std::size_t block = 64;
+		sy22::Voice voice = voices[0];
+		voice.configuration_pitch_bend.msb = 1;
+
+		sy22::PreviewSynth synth;
+		synth.set_sample_rate(sample_rate);
+		synth.set_voice(voice);
+		std::vector<float> left(block), right(block);
+
+		results.push_back(measure("preview", notes,
+					static_cast<std::size_t>(sample_rate) * 2 * sizeof(float), [&] {
+			for (std::size_t i = 0; i < notes; i++) {
+				synth.note_on(48 + 2 * static_cast<int>(i), 100);
+			}
+			for (std::size_t s = 0; s < sample_rate; s += block) {
+				synth.render(left.data(), right.data(), block);
+			}
+			synth.all_notes_off();
+			sink = static_cast<int>(left[0]);
+		}));
+	}
+
+	print(results, tsv);
+	if (!tsv) {
+		const Result& preview = results.back();
+		std::printf("preview: %zu notes take %.1f%% of one core\n",
+				preview.voices, preview.ns_per_voice * preview.voices / 1e7);
+	}
+	return 0;
+}
@@ -0,0 +1,476 @@
+/**
+ * Batch operations on .syx files.
+ *
+ * Usage:
+ *   sy22 validate FILE...         check every Single Voice Dump
+ *   sy22 check [-j N] [--repair] FILE...
+ *                                 check files in parallel, print a summary
+ *   sy22 fix IN OUT               recalculate checksums of voice dumps
+ *   sy22 list FILE...             print numbered voice names
+ *   sy22 extract IN N OUT         write voice N (as numbered by list)
+ *   sy22 merge OUT FILE...        write all valid voices into one file
+ *   sy22 simulate [OPTIONS] [FILE]
+ *                                 upload a bank to a simulated SY22 with
+ *                                 read-back, print throughput and drops
+ *   sy22 render [-j N] [--rate HZ] DIR FILE...
+ *                                 write a .wav preview of every voice
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "BankUpload.h"
+#include "BatchCheck.h"
+#include "BatchRender.h"
+#include "Librarian.h"
+#include "SimulatedDevice.h"
+#include "Sy22.h"
+#include "SysExParser.h"
+#include "TransmitScheduler.h"
+
+namespace {
+
+	const char usage[] =
+		"usage: sy22 validate FILE...\n"
+		"       sy22 check [-j N] [--repair] FILE...\n"
+		"       sy22 fix IN OUT\n"
+		"       sy22 list FILE...\n"
+		"       sy22 extract IN N OUT\n"
+		"       sy22 merge OUT FILE...\n"
+		"       sy22 simulate [--buffer BYTES] [--processing MS] [--gap MS]\n"
+		"                     [--window N] [FILE]\n"
+		"       sy22 render [-j N] [--rate HZ] DIR FILE...\n";
+
+	const sy22::SingleVoiceDump* as_dump(const unsigned char* data,
+			std::size_t size) {
+		if (size != sizeof(sy22::SingleVoiceDump)) {
+			return nullptr;
+		}
+		return reinterpret_cast<const sy22::SingleVoiceDump*>(data);
+	}
+
+	std::string voice_name(const sy22::Voice& v) {
+		return std::string(v.name, sizeof(v.name));
+	}
+
+	bool open(sy22::MappedFile& file, const char* path) {
+		if (!file.open(path)) {
+			std::fprintf(stderr, "sy22: cannot read %s\n", path);
+			return false;
+		}
+		return true;
+	}
+
+	bool write(const char* path, const std::vector<unsigned char>& data) {
+		std::FILE* out = std::fopen(path, "wb");
+		bool ok = out && std::fwrite(data.data(), 1, data.size(), out) == data.size();
+		if (out && std::fclose(out) != 0) {
+			ok = false;
+		}
+		if (!ok) {
+			std::fprintf(stderr, "sy22: cannot write %s\n", path);
+		}
+		return ok;
+	}
+
+	/**
+	 * Collect valid voice dumps of given files, in order.
+	 */
+	bool collect(char** paths, int count,
+			std::vector<sy22::SingleVoiceDump>& dumps) {
+		for (int i = 0; i < count; i++) {
+			sy22::MappedFile file;
+			if (!open(file, paths[i])) {
+				return false;
+			}
+			sy22::for_each_message(file.data(), file.size(),
+					[&](std::size_t, const unsigned char* data, std::size_t size) {
+				const sy22::SingleVoiceDump* svd = as_dump(data, size);
+				if (svd && sy22::is_valid(*svd)) {
+					dumps.push_back(*svd);
+				}
+			});
+		}
+		return true;
+	}
+
+	int validate(char** paths, int count) {
+		int errors = 0;
+
+		for (int i = 0; i < count; i++) {
+			sy22::MappedFile file;
+			if (!open(file, paths[i])) {
+				errors++;
+				continue;
+			}
+
+			bool terminated = sy22::for_each_message(file.data(), file.size(),
+					[&](std::size_t offset, const unsigned char* data,
+						std::size_t size) {
+				const sy22::SingleVoiceDump* svd = as_dump(data, size);
+				if (!svd || !sy22::is_framed(*svd)) {
+					return;
+				}
+				bool valid = sy22::is_valid(*svd);
+				std::printf("%s:%zu: %s %s\n", paths[i], offset,
+						voice_name(svd->voice_data).c_str(),
+						valid ? "ok" : "bad checksum");
+				errors += !valid;
+			});
+
+			if (!terminated) {
+				std::printf("%s: truncated message\n", paths[i]);
+				errors++;
+			}
+		}
+
+		return errors ? 1 : 0;
+	}
+
+	int check(char** args, int count) {
+		unsigned threads = 0;
+		bool repair = false;
+		int i = 0;
+
+		for (; i < count && args[i][0] == '-'; i++) {
+			if (std::strcmp(args[i], "--repair") == 0) {
+				repair = true;
+			} else if (std::strcmp(args[i], "-j") == 0 && i + 1 < count) {
+				threads = std::strtoul(args[++i], nullptr, 10);
+			} else {
+				std::fputs(usage, stderr);
+				return 2;
+			}
+		}
+
+		std::vector<std::string> paths(args + i, args + count);
+		std::vector<sy22::FileReport> reports =
+			sy22::check_files(paths, repair, threads);
+
+		std::size_t unreadable = 0, truncated = 0, voices = 0, bad_sysex = 0,
+			bad_voice = 0, broken_files = 0, broken = 0, repaired = 0;
+
+		for (std::size_t f = 0; f < reports.size(); f++) {
+			const sy22::FileReport& r = reports[f];
+			if (!r.readable) {
+				std::printf("%s: cannot read\n", paths[f].c_str());
+			} else if (!r.ok()) {
+				std::printf("%s: %zu voices, %zu bad SysEx checksums, "
+						"%zu bad voice checksums%s%s\n", paths[f].c_str(),
+						r.voices, r.bad_sysex_checksums, r.bad_voice_checksums,
+						r.truncated ? ", truncated" : "",
+						r.repaired ? ", repaired" : "");
+			}
+			unreadable += !r.readable;
+			truncated += r.truncated;
+			voices += r.voices;
+			bad_sysex += r.bad_sysex_checksums;
+			bad_voice += r.bad_voice_checksums;
+			broken_files += r.readable && !r.ok();
+			broken += r.broken;
+			repaired += r.repaired;
+		}
+
+		std::printf("%zu files, %zu unreadable, %zu with errors, %zu truncated\n"
+				"%zu voices, %zu bad SysEx checksums, %zu bad voice checksums, "
+				"%zu repaired\n",
+				reports.size(), unreadable, broken_files, truncated,
+				voices, bad_sysex, bad_voice, repaired);
+
+		bool clean = unreadable == 0 && truncated == 0 && repaired == broken;
+		return clean ? 0 : 1;
+	}
+
+	int fix(const char* in, const char* out) {
+		sy22::MappedFile file;
+		if (!open(file, in)) {
+			return 1;
+		}
+
+		std::vector<unsigned char> result(file.data(), file.data() + file.size());
+		int fixed = 0;
+
+		sy22::for_each_message(result.data(), result.size(),
+				[&](std::size_t offset, const unsigned char* data, std::size_t size) {
+			const sy22::SingleVoiceDump* svd = as_dump(data, size);
+			if (svd && sy22::is_framed(*svd) && !sy22::is_valid(*svd)) {
+				reinterpret_cast<sy22::SingleVoiceDump*>(&result[offset])->
+					update_checksum();
+				fixed++;
+			}
+		});
+
+		if (!write(out, result)) {
+			return 1;
+		}
+		std::printf("%d voices fixed\n", fixed);
+		return 0;
+	}
+
+	int list(char** paths, int count) {
+		std::vector<sy22::SingleVoiceDump> dumps;
+		if (!collect(paths, count, dumps)) {
+			return 1;
+		}
+		for (std::size_t i = 0; i < dumps.size(); i++) {
+			std::printf("%3zu %s\n", i + 1, voice_name(dumps[i].voice_data).c_str());
+		}
+		return 0;
+	}
+
+	int extract(char* in, const char* number, const char* out) {
+		std::vector<sy22::SingleVoiceDump> dumps;
+		if (!collect(&in, 1, dumps)) {
+			return 1;
+		}
+
+		char* end;
+		unsigned long n = std::strtoul(number, &end, 10);
+		if (*end || n < 1 || n > dumps.size()) {
+			std::fprintf(stderr, "sy22: no voice %s in %s\n", number, in);
+			return 1;
+		}
+
+		const unsigned char* data =
+			reinterpret_cast<const unsigned char*>(&dumps[n - 1]);
+		return write(out, std::vector<unsigned char>(
+					data, data + sizeof(sy22::SingleVoiceDump))) ? 0 : 1;
+	}
+
+	int merge(const char* out, char** paths, int count) {
+		std::vector<sy22::SingleVoiceDump> dumps;
+		if (!collect(paths, count, dumps)) {
+			return 1;
+		}
+
+		const unsigned char* data =
+			reinterpret_cast<const unsigned char*>(dumps.data());
+		if (!write(out, std::vector<unsigned char>(
+					data, data + dumps.size() * sizeof(sy22::SingleVoiceDump)))) {
+			return 1;
+		}
+		std::printf("%zu voices merged\n", dumps.size());
+		return 0;
+	}
+
+	int render(char** args, int count) {
+		sy22::RenderSettings settings = sy22::default_render_settings();
+		unsigned threads = 0;
+		int i = 0;
+
+		for (; i + 1 < count && args[i][0] == '-'; i += 2) {
+			if (std::strcmp(args[i], "-j") == 0) {
+				threads = std::strtoul(args[i + 1], nullptr, 10);
+			} else if (std::strcmp(args[i], "--rate") == 0) {
+				settings.sample_rate = std::strtoul(args[i + 1], nullptr, 10);
+			} else {
+				break;
+			}
+		}
+		if (count - i < 2 || args[i][0] == '-' ||
+				settings.sample_rate < 8000 || settings.sample_rate > 192000) {
+			std::fputs(usage, stderr);
+			return 2;
+		}
+
+		const std::string directory = args[i++];
+		sy22::Librarian library;
+		for (; i < count; i++) {
+			if (!library.add(args[i])) {
+				std::fprintf(stderr, "sy22: cannot read %s\n", args[i]);
+				return 1;
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		sy22::RenderReport report =
+			sy22::render_previews(library, directory, settings, threads);
+		std::chrono::duration<double> took =
+			std::chrono::steady_clock::now() - start;
+
+		std::printf("%zu previews written to %s, %zu failed\n"
+				"%.0f s of audio in %.1f s, %.0fx real time\n",
+				report.rendered, directory.c_str(), report.failed,
+				report.seconds, took.count(),
+				took.count() > 0.0 ? report.seconds / took.count() : 0.0);
+
+		return report.failed == 0 ? 0 : 1;
+	}
+
+	struct Message {
+		std::vector<unsigned char> data;
+		// Device needs its processing gap after this one
+		bool dump;
+	};
+
+	template <typename T>
+	void push(std::deque<Message>& queue, const T& message, bool dump) {
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(&message);
+		queue.push_back({std::vector<unsigned char>(data, data + sizeof(T)), dump});
+	}
+
+	/**
+	 * Upload a bank the way the plugin does, paced by TransmitScheduler,
+	 * to a SimulatedDevice looped back into a SysExParser.
+	 */
+	int simulate(char** args, int count) {
+		const double sample_rate = 44100.0;
+		const long block_size = 512;
+		std::size_t buffer = sy22::SimulatedDevice::default_input_buffer;
+		double processing = sy22::SimulatedDevice::default_processing_ms;
+		double gap = sy22::TransmitScheduler::default_gap_ms;
+		std::size_t window = sy22::BankUpload::default_window;
+		int i = 0;
+
+		for (; i + 1 < count && args[i][0] == '-'; i += 2) {
+			if (std::strcmp(args[i], "--buffer") == 0) {
+				buffer = std::strtoul(args[i + 1], nullptr, 10);
+			} else if (std::strcmp(args[i], "--processing") == 0) {
+				processing = std::strtod(args[i + 1], nullptr);
+			} else if (std::strcmp(args[i], "--gap") == 0) {
+				gap = std::strtod(args[i + 1], nullptr);
+			} else if (std::strcmp(args[i], "--window") == 0) {
+				window = std::strtoul(args[i + 1], nullptr, 10);
+			} else {
+				break;
+			}
+		}
+		if (count - i > 1 || (i < count && args[i][0] == '-')) {
+			std::fputs(usage, stderr);
+			return 2;
+		}
+
+		std::vector<sy22::Voice> voices(sy22::bank_voices, sy22::make_voice());
+		if (i < count) {
+			std::vector<sy22::SingleVoiceDump> dumps;
+			if (!collect(args + i, 1, dumps)) {
+				return 1;
+			}
+			for (std::size_t v = 0; v < dumps.size() && v < voices.size(); v++) {
+				voices[v] = dumps[v].voice_data;
+			}
+		} else {
+			// Distinct voices, so that a mix-up can't go unnoticed
+			for (std::size_t v = 0; v < voices.size(); v++) {
+				std::snprintf(voices[v].name, sizeof(voices[v].name), "SIM %02zu", v);
+				voices[v].name[7] = ' ';
+			}
+		}
+
+		sy22::TransmitScheduler scheduler;
+		scheduler.set_sample_rate(sample_rate);
+		scheduler.set_gap(gap / 1000.0);
+
+		sy22::SimulatedDevice device;
+		device.set_sample_rate(sample_rate);
+		device.set_input_buffer(buffer);
+		device.set_processing_time(processing / 1000.0);
+
+		sy22::SysExParser parser;
+		sy22::BankUpload upload;
+		upload.start(voices.data(), voices.size(), 2.0, window);
+
+		std::deque<Message> queue;
+		std::size_t sent_bytes = 0;
+		double now = 0.0;
+
+		while (upload.active()) {
+			if (queue.empty()) {
+				upload.update(now);
+			} else {
+				upload.hold(now);
+			}
+
+			std::size_t memory;
+			while (upload.next(memory, now)) {
+				const unsigned char program_change[] = {
+					0xC0, static_cast<unsigned char>(memory)
+				};
+				queue.push_back({std::vector<unsigned char>(
+							program_change, program_change + 2), false});
+				sy22::SingleVoiceDump svd;
+				sy22::encode_svd(upload.voice(memory), svd);
+				push(queue, svd, true);
+				push(queue, sy22::make_dump_request(), false);
+			}
+
+			long slot;
+			while (!queue.empty() && (slot = scheduler.next_slot(block_size)) >= 0) {
+				const Message& m = queue.front();
+				device.receive(m.data.data(), m.data.size(), slot);
+				scheduler.sent(slot, m.data.size(), m.dump);
+				sent_bytes += m.data.size();
+				queue.pop_front();
+			}
+			scheduler.advance(block_size);
+			device.advance(block_size);
+			now += block_size / sample_rate;
+
+			sy22::SingleVoiceDump svd;
+			while (device.answer(svd)) {
+				const unsigned char* data = reinterpret_cast<const unsigned char*>(&svd);
+				std::size_t offset = 0, consumed;
+				while (offset < sizeof(svd)) {
+					if (parser.feed(data + offset, sizeof(svd) - offset, consumed)
+							== sy22::SysExParser::voice_received) {
+						upload.received(parser.voice(), now);
+					}
+					offset += consumed;
+				}
+			}
+		}
+
+		const sy22::SimulatedDevice::Stats& s = device.stats();
+		std::printf("%zu voices verified, %zu failed, %zu sent again\n"
+				"%.2f s, %zu bytes sent, %.0f bytes/s\n"
+				"%zu bytes dropped, input buffer peak %zu of %zu bytes\n"
+				"%zu dumps stored, %zu checksum errors, %zu broken messages, "
+				"%zu requests dropped\n"
+				"worst dump latency %.1f ms, worst answer latency %.1f ms\n",
+				upload.verified_count(), upload.failed_count(), upload.retransmits(),
+				s.elapsed, sent_bytes, sent_bytes / s.elapsed,
+				s.bytes_dropped, s.max_buffer_fill, buffer,
+				s.dumps_stored, s.checksum_errors, s.broken_messages,
+				s.requests_dropped,
+				s.max_dump_latency * 1000.0, s.max_answer_latency * 1000.0);
+
+		return upload.failed_count() == 0 ? 0 : 1;
+	}
+
+};
+
+int main(int argc, char** argv) {
+	if (argc >= 2 && std::strcmp(argv[1], "simulate") == 0) {
+		return simulate(argv + 2, argc - 2);
+	}
+
+	if (argc < 3) {
+		std::fputs(usage, stderr);
+		return 2;
+	}
+
+	std::string command = argv[1];
+
+	if (command == "validate") {
+		return validate(argv + 2, argc - 2);
+	} else if (command == "check") {
+		return check(argv + 2, argc - 2);
+	} else if (command == "fix" && argc == 4) {
+		return fix(argv[2], argv[3]);
+	} else if (command == "list") {
+		return list(argv + 2, argc - 2);
+	} else if (command == "extract" && argc == 5) {
+		return extract(argv[2], argv[3], argv[4]);
+	} else if (command == "merge" && argc >= 4) {
+		return merge(argv[2], argv + 3, argc - 3);
+	} else if (command == "render") {
+		return render(argv + 2, argc - 2);
+	}
+
+	std::fputs(usage, stderr);
+	return 2;
+}
@@ -0,0 +1,518 @@
+/**
+ * Checks of the sy22 core that a compile can't make.
+ *
+ * Usage: sy22-test
+ *
+ * Runs every check, prints the failures and exits non-zero if there
+ * were any.
+ */
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+#include "AllocationCounter.h"
+#include "BankUpload.h"
+#include "BatchCheck.h"
+#include "Librarian.h"
+#include "OutputArbiter.h"
+#include "PreviewSynth.h"
+#include "ProgramBank.h"
+#include "SavedState.h"
+#include "SimulatedDevice.h"
+#include "SpscQueue.h"
+#include "Sy22.h"
+#include "SysExParser.h"
+#include "TransmitScheduler.h"
+#include "VoiceParams.h"
+
+namespace {
+
+	int failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+	void check(bool ok, const char* what, const char* file, int line) {
+		if (!ok) {
+			std::printf("%s:%d: failed: %s\n", file, line, what);
+			failures++;
+		}
+	}
+
+	/**
+	 * Run the core pieces processBlock uses, the way it uses them, for
+	 * a few seconds of blocks: bank upload traffic through the
+	 * scheduler and arbiter to a simulated SY22, its answers through
+	 * the parser and queues, and the preview synth playing. Nothing may
+	 * touch the heap once the blocks run.
+	 */
+	void audio_path_does_not_allocate() {
+		const double rate = 44100.0;
+		const long block = 64;
+
+		static sy22::SingleVoiceDump dumps[sy22::bank_voices];
+		for (std::size_t i = 0; i < sy22::bank_voices; i++) {
+			sy22::Voice v = sy22::make_voice();
+			v.name[0] = static_cast<char>('A' + i % 26);
+			sy22::encode_svd(v, dumps[i]);
+		}
+		const sy22::DumpRequest request = sy22::make_dump_request();
+
+		sy22::TransmitScheduler scheduler;
+		sy22::OutputArbiter arbiter;
+		static sy22::SimulatedDevice device;
+		sy22::SysExParser parser;
+		static sy22::PreviewSynth synth;
+		static sy22::SpscQueue<sy22::Voice, 8> received;
+		scheduler.set_sample_rate(rate);
+		arbiter.set_sample_rate(rate);
+		device.set_sample_rate(rate);
+		synth.set_sample_rate(rate);
+		synth.set_voice(dumps[0].voice_data);
+
+		float left[block], right[block];
+		sy22::SingleVoiceDump answer;
+		std::size_t next = 0;
+		std::size_t answers = 0;
+
+		const long before = sy22::scoped_allocations();
+		{
+			const sy22::AllocationScope scope;
+			for (long b = 0; b < 4 * static_cast<long>(rate) / block; b++) {
+				arbiter.begin_block();
+				if (b % 400 == 0) {
+					arbiter.channel_event(block / 2);
+					synth.note_on(60 + b / 400 % 12, 100);
+				}
+
+				// Alternate dumps and requests, as a verified upload does
+				const bool is_dump = next % 2 == 0;
+				const void* unit = is_dump ?
+					static_cast<const void*>(&dumps[next / 2 % sy22::bank_voices]) :
+					static_cast<const void*>(&request);
+				const std::size_t size = is_dump ? sizeof(sy22::SingleVoiceDump) :
+					sizeof(sy22::DumpRequest);
+				const long slot = scheduler.next_slot(block);
+				const double wire = scheduler.duration_samples(size, false);
+				const long start = slot < 0 ? -1 : arbiter.place(slot, wire, block);
+				if (start >= 0) {
+					device.receive(static_cast<const unsigned char*>(unit), size, start);
+					scheduler.sent(start, size, is_dump);
+					arbiter.sent(start, wire);
+					next++;
+				}
+
+				device.advance(block);
+				while (device.answer(answer)) {
+					std::size_t consumed;
+					if (parser.feed(reinterpret_cast<const unsigned char*>(&answer),
+								sizeof(answer), consumed) ==
+							sy22::SysExParser::voice_received) {
+						received.push(parser.voice());
+					}
+				}
+				sy22::Voice v;
+				while (received.pop(v)) {
+					answers++;
+				}
+
+				std::memset(left, 0, sizeof(left));
+				std::memset(right, 0, sizeof(right));
+				synth.render(left, right, block);
+
+				scheduler.advance(block);
+				arbiter.end_block(block);
+			}
+		}
+
+		CHECK(sy22::allocations_counted());
+		CHECK(sy22::scoped_allocations() == before);
+		// The traffic did flow
+		CHECK(device.stats().dumps_stored > 0);
+		CHECK(answers > 0);
+	}
+
+	/**
+	 * The counter behind the check above sees allocations inside a
+	 * scope, and only those.
+	 */
+	void allocation_scope_counts() {
+		const long before = sy22::scoped_allocations();
+		{
+			const sy22::AllocationScope scope;
+			std::string counted(100, 'x');
+			CHECK(counted[99] == 'x');
+		}
+		std::string uncounted(100, 'x');
+		CHECK(uncounted[99] == 'x');
+		CHECK(sy22::scoped_allocations() == before + 1);
+	}
+
+	bool write_file(const std::string& path, const void* data, std::size_t size) {
+		std::FILE* f = std::fopen(path.c_str(), "wb");
+		if (!f) {
+			return false;
+		}
+		const bool ok = std::fwrite(data, size, 1, f) == 1;
+		return std::fclose(f) == 0 && ok;
+	}
+
+	/**
+	 * A file rewritten with the same size right after being indexed
+	 * must not be served from the stale index.
+	 */
+	void index_notices_quick_rewrite() {
+		char path[] = "/tmp/sy22-test-XXXXXX";
+		const int fd = mkstemp(path);
+		CHECK(fd >= 0);
+		if (fd < 0) {
+			return;
+		}
+		close(fd);
+
+		sy22::Voice v = sy22::make_voice();
+		std::memcpy(v.name, "BEFORE  ", sizeof(v.name));
+		sy22::SingleVoiceDump svd;
+		sy22::encode_svd(v, svd);
+		CHECK(write_file(path, &svd, sizeof(svd)));
+		{
+			sy22::Librarian library;
+			CHECK(library.add(path) && library.size() == 1);
+		}
+
+		std::memcpy(v.name, "AFTER   ", sizeof(v.name));
+		sy22::encode_svd(v, svd);
+		CHECK(write_file(path, &svd, sizeof(svd)));
+		{
+			sy22::Librarian library;
+			CHECK(library.add(path) && library.size() == 1 &&
+					std::memcmp(library.entry(0).name, "AFTER   ", 8) == 0);
+		}
+
+		std::remove(path);
+		std::remove(sy22::Librarian::index_path(path).c_str());
+	}
+
+	/**
+	 * A dump cut off by the start of the next one is reported as
+	 * truncated, and the next one is still found.
+	 */
+	void truncated_dump_keeps_the_next() {
+		sy22::Voice v = sy22::make_voice();
+		std::memcpy(v.name, "SECOND  ", sizeof(v.name));
+		sy22::SingleVoiceDump svd;
+		sy22::encode_svd(v, svd);
+
+		const std::size_t cut = 300;
+		unsigned char data[cut + sizeof(svd)];
+		std::memcpy(data, &svd, cut);
+		std::memcpy(data + cut, &svd, sizeof(svd));
+
+		std::size_t found = 0, offset = 0;
+		const bool complete = sy22::for_each_message(data, sizeof(data),
+				[&](std::size_t o, const unsigned char*, std::size_t size) {
+			found++;
+			offset = o;
+			CHECK(size == sizeof(svd));
+		});
+		CHECK(!complete);
+		CHECK(found == 1 && offset == cut);
+
+		char path[] = "/tmp/sy22-test-XXXXXX";
+		const int fd = mkstemp(path);
+		CHECK(fd >= 0);
+		if (fd < 0) {
+			return;
+		}
+		close(fd);
+		CHECK(write_file(path, data, sizeof(data)));
+		const sy22::FileReport report = sy22::check_file(path, false);
+		CHECK(report.readable && report.truncated && report.voices == 1);
+		std::remove(path);
+
+		// Cut off by the end of data
+		CHECK(!sy22::for_each_message(data, cut, [](std::size_t,
+						const unsigned char*, std::size_t) {}));
+	}
+
+	/**
+	 * Names from the host may be any UTF-8, dumps must stay 7-bit. A
+	 * dump that isn't is not valid, whatever its checksums say.
+	 */
+	void program_names_stay_seven_bit() {
+		sy22::ProgramBank bank;
+		const char name[] = "\xC3\x9C" "ber" "\xF7" "\tX" "\xE2\x82\xAC" "!";
+		bank.set_name(3, name, sizeof(name) - 1);
+		CHECK(std::memcmp(bank.voice(3).name, "?ber??X?", 8) == 0);
+		CHECK(sy22::is_valid(bank.dump(3)));
+
+		sy22::SingleVoiceDump svd = bank.dump(3);
+		// Checksums can be made to agree with bit 7 set
+		reinterpret_cast<unsigned char*>(svd.voice_data.name)[0] |= 0x80;
+		svd.update_checksum();
+		CHECK(sy22::sysex_checksum_ok(svd) && sy22::checksum_ok(svd.voice_data));
+		CHECK(!sy22::is_valid(svd));
+
+		static unsigned char state[sy22::state_header_size + sizeof(sy22::BankDump)];
+		sy22::write_state_header(state, 1, 0);
+		std::memcpy(sy22::state_bank(state, 0), &bank.dumps(), sizeof(sy22::BankDump));
+		sy22::StateInfo info;
+		CHECK(sy22::read_state(state, sizeof(state), info));
+		std::memcpy(sy22::state_bank(state, 0) + 3 * sizeof(svd), &svd, sizeof(svd));
+		CHECK(!sy22::read_state(state, sizeof(state), info));
+	}
+
+	/**
+	 * A saved state is only read if its size is exactly what the header
+	 * says, whatever bank count the header claims.
+	 */
+	void state_checks_bank_count() {
+		static unsigned char state[sy22::state_header_size + sizeof(sy22::BankDump)];
+		sy22::write_state_header(state, 1, 0);
+		sy22::SingleVoiceDump svd;
+		sy22::encode_svd(sy22::make_voice(), svd);
+		for (std::size_t i = 0; i < sy22::bank_voices; i++) {
+			std::memcpy(sy22::state_bank(state, 0) + i * sizeof(svd), &svd, sizeof(svd));
+		}
+
+		sy22::StateInfo info;
+		CHECK(sy22::read_state(state, sizeof(state), info) && info.banks == 1);
+		CHECK(!sy22::read_state(state, sizeof(state) - 1, info));
+		sy22::write_state_header(state, 0xFFFFFFFF, 0);
+		CHECK(!sy22::read_state(state, sizeof(state), info));
+		sy22::write_state_header(state, 2, 0);
+		CHECK(!sy22::read_state(state, sizeof(state), info));
+	}
+
+	/**
+	 * The SY35 codecs read back what they write, and a state keeps the
+	 * model it was saved with.
+	 */
+	void sy35_model_round_trips() {
+		sy22::Voice v = sy22::make_voice();
+		std::memcpy(v.name, "SY35TEST", sizeof(v.name));
+		sy22::SingleVoiceDump svd;
+		sy22::encode_svd<sy22::Sy35Model>(v, svd);
+		CHECK(sy22::is_valid<sy22::Sy35Model>(svd));
+
+		sy22::Sy35SysExParser parser;
+		std::size_t consumed;
+		CHECK(parser.feed(reinterpret_cast<const unsigned char*>(&svd), sizeof(svd), consumed)
+				== sy22::Sy35SysExParser::voice_received);
+		CHECK(sy22::content_hash(parser.voice()) == sy22::content_hash(v));
+
+		static unsigned char state[sy22::state_header_size + sizeof(sy22::BankDump)];
+		sy22::write_state_header(state, 1, 0, sy22::model_sy35);
+		for (std::size_t i = 0; i < sy22::bank_voices; i++) {
+			std::memcpy(sy22::state_bank(state, 0) + i * sizeof(svd), &svd, sizeof(svd));
+		}
+		sy22::StateInfo info;
+		CHECK(sy22::read_state(state, sizeof(state), info) && info.model == sy22::model_sy35);
+		sy22::write_state_header(state, 1, 0);
+		CHECK(sy22::read_state(state, sizeof(state), info) && info.model == sy22::model_sy22);
+	}
+
+	/**
+	 * Upload a bank padded with identical voices to a device that loses,
+	 * or delays past the timeout, the answer to the first request. No
+	 * voice memory may be verified by an answer that wasn't its own.
+	 */
+	void upload_matches_duplicate_answers(bool late) {
+		const std::size_t count = 6;
+		const double timeout = 1.0;
+		const double delay = 0.3;
+		sy22::Voice voices[count];
+		for (std::size_t i = 0; i < count; i++) {
+			voices[i] = sy22::make_voice();
+		}
+		std::memcpy(voices[2].name, "DISTINCT", sizeof(voices[2].name));
+
+		sy22::BankUpload upload;
+		upload.start(voices, count, timeout);
+
+		// Answers on their way: memory and arrival time, in order
+		std::size_t pending[64];
+		double arrival[64];
+		std::size_t head = 0, tail = 0;
+		bool answered[count] = {};
+		bool first = true;
+
+		for (double now = 0.0; upload.active() && now < 100.0; now += 0.1) {
+			std::size_t memory;
+			while (upload.next(memory, now)) {
+				if (first && !late) {
+					first = false;
+					continue;
+				}
+				pending[tail % 64] = memory;
+				arrival[tail % 64] = now + (first ? timeout + delay : delay);
+				first = false;
+				tail++;
+			}
+
+			while (head != tail && arrival[head % 64] <= now) {
+				const std::size_t m = pending[head++ % 64];
+				answered[m] = true;
+				upload.received(upload.voice(m), now);
+				for (std::size_t i = 0; i < count; i++) {
+					CHECK(upload.state(i) != sy22::BankUpload::verified || answered[i]);
+				}
+			}
+
+			upload.update(now);
+		}
+
+		CHECK(!upload.active() && upload.verified_count() == count);
+	}
+
+	/**
+	 * Upload count distinct voices to a SimulatedDevice the way
+	 * sy22 simulate does, losing the first answer that reads back the
+	 * last voice. Sending it again must verify it, even when it is the
+	 * only voice in flight.
+	 */
+	void upload_survives_lost_tail_answer(std::size_t count, std::size_t window) {
+		const double sample_rate = 44100.0;
+		const long block_size = 512;
+		sy22::Voice voices[sy22::bank_voices];
+		for (std::size_t i = 0; i < count; i++) {
+			voices[i] = sy22::make_voice();
+			voices[i].name[7] = static_cast<char>('A' + i);
+		}
+
+		sy22::TransmitScheduler scheduler;
+		scheduler.set_sample_rate(sample_rate);
+		sy22::SimulatedDevice device;
+		device.set_sample_rate(sample_rate);
+		sy22::SysExParser parser;
+		sy22::BankUpload upload;
+		upload.start(voices, count, 2.0, window);
+
+		// Messages waiting for a slot, in order
+		struct Message {
+			unsigned char data[sizeof(sy22::SingleVoiceDump)];
+			std::size_t size;
+			bool dump;
+		} queue[64];
+		std::size_t head = 0, tail = 0;
+		bool dropped = false;
+		double now = 0.0;
+
+		while (upload.active() && now < 60.0) {
+			if (head == tail) {
+				upload.update(now);
+			} else {
+				upload.hold(now);
+			}
+
+			std::size_t memory;
+			while (upload.next(memory, now)) {
+				sy22::SingleVoiceDump svd;
+				sy22::encode_svd(upload.voice(memory), svd);
+				const sy22::DumpRequest request = sy22::make_dump_request();
+				Message& pc = queue[tail++ % 64];
+				pc.data[0] = 0xC0;
+				pc.data[1] = static_cast<unsigned char>(memory);
+				pc.size = 2;
+				pc.dump = false;
+				Message& dump = queue[tail++ % 64];
+				std::memcpy(dump.data, &svd, sizeof(svd));
+				dump.size = sizeof(svd);
+				dump.dump = true;
+				Message& req = queue[tail++ % 64];
+				std::memcpy(req.data, &request, sizeof(request));
+				req.size = sizeof(request);
+				req.dump = false;
+			}
+
+			long slot;
+			while (head != tail && (slot = scheduler.next_slot(block_size)) >= 0) {
+				const Message& m = queue[head++ % 64];
+				device.receive(m.data, m.size, slot);
+				scheduler.sent(slot, m.size, m.dump);
+			}
+			scheduler.advance(block_size);
+			device.advance(block_size);
+			now += block_size / sample_rate;
+
+			sy22::SingleVoiceDump svd;
+			while (device.answer(svd)) {
+				if (!dropped && sy22::content_hash(svd.voice_data)
+						== sy22::content_hash(voices[count - 1])) {
+					dropped = true;
+					continue;
+				}
+				const unsigned char* data = reinterpret_cast<const unsigned char*>(&svd);
+				std::size_t offset = 0, consumed;
+				while (offset < sizeof(svd)) {
+					if (parser.feed(data + offset, sizeof(svd) - offset, consumed)
+							== sy22::SysExParser::voice_received) {
+						upload.received(parser.voice(), now);
+					}
+					offset += consumed;
+				}
+			}
+		}
+
+		CHECK(dropped);
+		CHECK(!upload.active());
+		CHECK(upload.verified_count() == count && upload.failed_count() == 0);
+		for (std::size_t i = 0; i < count; i++) {
+			CHECK(sy22::content_hash(device.memory(i)) == sy22::content_hash(voices[i]));
+		}
+	}
+
+	/**
+	 * Numbers out of a field's range are clamped to it on the way to
+	 * Voice data, and the fields of an init voice go through untouched.
+	 */
+	void params_clamp_to_field_ranges() {
+		const sy22::Voice init = sy22::make_voice();
+		const sy22::Voice same = sy22::to_voice(sy22::to_params(init));
+		CHECK(std::memcmp(&same, &init, offsetof(sy22::Voice, checksum)) == 0);
+
+		sy22::VoiceParams p = sy22::to_params(init);
+		p.B.feedback = 100;
+		p.common_ar = -100;
+		p.common_rr = 100;
+		p.A.pitch_shift = 13;
+		p.vector.level[0].x = -40;
+		const sy22::Voice v = sy22::to_voice(p);
+		CHECK(v.B.feedback == 7);
+		CHECK(v.common_ar.msb == 1 && v.common_ar.lsb == 0x40);
+		CHECK(v.common_rr.msb == 0 && v.common_rr.lsb == 0x3F);
+		CHECK(v.A.pitch_shift.msb == 0 && v.A.pitch_shift.lsb == 12);
+		CHECK(v.vector.level[0].x == 0);
+		CHECK(sy22::checksum_ok(v));
+
+		const sy22::VoiceParams q = sy22::to_params(v);
+		CHECK(q.B.feedback == 7 && q.common_ar == -64 && q.common_rr == 63 &&
+				q.A.pitch_shift == 12 && q.vector.level[0].x == -31);
+	}
+
+};
+
+int main() {
+	allocation_scope_counts();
+	audio_path_does_not_allocate();
+	index_notices_quick_rewrite();
+	truncated_dump_keeps_the_next();
+	state_checks_bank_count();
+	sy35_model_round_trips();
+	program_names_stay_seven_bit();
+	upload_matches_duplicate_answers(false);
+	upload_matches_duplicate_answers(true);
+	upload_survives_lost_tail_answer(6, sy22::BankUpload::default_window);
+	upload_survives_lost_tail_answer(6, 1);
+	upload_survives_lost_tail_answer(1, 1);
+	params_clamp_to_field_ranges();
+
+	if (failures) {
+		std::printf("%d checks failed\n", failures);
+		return 1;
+	}
+	std::printf("all checks passed\n");
+	return 0;
+}